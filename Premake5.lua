@@ -148,6 +148,12 @@ for k, proj in pairs(projects) do
 			"external/gzip/zlib.lib"
 		}
 
+		-- Projects can add their own settings (ex: sharing source files with another project) by
+		-- providing a project.lua in their root folder
+		if os.isfile(proj .. "/project.lua") then
+			dofile(proj .. "/project.lua")
+		end
+
 		-- This filters for our windows builds
 		filter "system:windows"
 			systemversion "latest"
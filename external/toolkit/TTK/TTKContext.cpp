@@ -149,24 +149,13 @@ TTK::Context::Context() {
 
 
 	m_Tris = __InitBuff(GL_TRIANGLES, m_ShaderHandle, m_TriVerts, sizeof(SimpleVert), MaxTriVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
+	VertexLayoutOf<SimpleVert>::Apply();
 
 	m_Lines = __InitBuff(GL_LINES, m_ShaderHandle, m_LineVerts, sizeof(SimpleVert), MaxLineVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(SimpleVert), (void*)offsetof(SimpleVert, Color));
+	VertexLayoutOf<SimpleVert>::Apply();
 
 	m_Points = __InitBuff(GL_POINTS, m_PointShaderHandle, m_PointVerts, sizeof(PointVert), MaxLineVerts);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Position));
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Color));
-	glVertexAttribPointer(2, 1, GL_FLOAT, false, sizeof(PointVert), (void*)offsetof(PointVert, Size));
+	VertexLayoutOf<PointVert>::Apply();
 
 	glBindVertexArray(0);
 
@@ -15,6 +15,7 @@
 
 #include <GLM/glm.hpp>
 #include "FontRenderer.h"
+#include "../VertexLayout.h"
 
 namespace TTK
 {
@@ -111,3 +112,13 @@ namespace TTK
 		SimpleVert m_TriVerts[MaxTriVerts];
 	};
 }
+
+VERTEX_LAYOUT(TTK::Context::SimpleVert,
+	VertexAttribute<&TTK::Context::SimpleVert::Position, 0>,
+	VertexAttribute<&TTK::Context::SimpleVert::Color,    1>
+);
+VERTEX_LAYOUT(TTK::Context::PointVert,
+	VertexAttribute<&TTK::Context::PointVert::Position, 0>,
+	VertexAttribute<&TTK::Context::PointVert::Color,    1>,
+	VertexAttribute<&TTK::Context::PointVert::Size,     2>
+);
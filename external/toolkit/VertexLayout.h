@@ -0,0 +1,127 @@
+/*
+	Compile-time descriptions of vertex formats. Each vertex type lists its attributes once, and the stride,
+	offsets and glVertexAttribPointer calls get generated from that list:
+
+		struct MyVertex { glm::vec3 Position; uint32_t Color; };
+		VERTEX_LAYOUT(MyVertex,
+			VertexAttribute<&MyVertex::Position, 0>,
+			VertexAttribute<&MyVertex::Color, 1, GL_UNSIGNED_BYTE, 4, true>
+		);
+
+		// With a VAO and GL_ARRAY_BUFFER bound
+		VertexLayoutOf<MyVertex>::Apply();
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Maps a C++ type to the OpenGL type and component count used to read it. Specialize this for any
+ * component types that aren't covered below
+ */
+template <typename T>
+struct VertexComponentTraits;
+
+template <> struct VertexComponentTraits<float>    { static constexpr GLenum Type = GL_FLOAT;          static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<int32_t>  { static constexpr GLenum Type = GL_INT;            static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<uint32_t> { static constexpr GLenum Type = GL_UNSIGNED_INT;   static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<int16_t>  { static constexpr GLenum Type = GL_SHORT;          static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<uint16_t> { static constexpr GLenum Type = GL_UNSIGNED_SHORT; static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<int8_t>   { static constexpr GLenum Type = GL_BYTE;           static constexpr GLint Components = 1; };
+template <> struct VertexComponentTraits<uint8_t>  { static constexpr GLenum Type = GL_UNSIGNED_BYTE;  static constexpr GLint Components = 1; };
+
+// GLM vectors use their component type, with one component per element
+template <glm::length_t L, typename T, glm::qualifier Q>
+struct VertexComponentTraits<glm::vec<L, T, Q>> {
+	static constexpr GLenum Type       = VertexComponentTraits<T>::Type;
+	static constexpr GLint  Components = L;
+};
+
+// Fixed size arrays (ex: uint16_t[3] for half floats) use their element type, with one component per element
+template <typename T, size_t N>
+struct VertexComponentTraits<T[N]> {
+	static constexpr GLenum Type       = VertexComponentTraits<T>::Type;
+	static constexpr GLint  Components = static_cast<GLint>(N * VertexComponentTraits<T>::Components);
+};
+
+/*
+ * Extracts the class and member type from a pointer to member
+ */
+template <typename T>
+struct MemberPointerTraits;
+
+template <typename C, typename M>
+struct MemberPointerTraits<M C::*> {
+	typedef C Class;
+	typedef M Member;
+};
+
+/*
+ * Describes a single attribute of a vertex type
+ * @param Member     A pointer to the member that stores the attribute (ex: &Vertex::Position)
+ * @param Location   The attribute location that the shader reads the attribute from
+ * @param Type       The OpenGL type of each component, deduced from the member by default
+ * @param Components The number of components in the attribute, deduced from the member by default
+ * @param Normalized True if integer data should be normalized to [0, 1] or [-1, 1] when read as a float
+ */
+template <
+	auto   Member,
+	GLuint Location,
+	GLenum Type       = VertexComponentTraits<typename MemberPointerTraits<decltype(Member)>::Member>::Type,
+	GLint  Components = VertexComponentTraits<typename MemberPointerTraits<decltype(Member)>::Member>::Components,
+	bool   Normalized = false>
+struct VertexAttribute {
+	typedef typename MemberPointerTraits<decltype(Member)>::Class VertexType;
+
+	// Gets the offset of the attribute within the vertex, using a null vertex like we always have
+	static size_t GetOffset() {
+		return reinterpret_cast<size_t>(&(static_cast<const VertexType*>(nullptr)->*Member));
+	}
+
+	/*
+	 * Enables and sets up the attribute on the currently bound VAO, reading from the currently bound GL_ARRAY_BUFFER
+	 * @param baseOffset The offset in bytes of the first vertex in the buffer
+	 */
+	static void Apply(size_t baseOffset = 0) {
+		glEnableVertexAttribArray(Location);
+		glVertexAttribPointer(Location, Components, Type, Normalized, sizeof(VertexType), reinterpret_cast<const void*>(baseOffset + GetOffset()));
+	}
+};
+
+/*
+ * A full vertex format, made up of a list of VertexAttributes that all belong to TVertex
+ */
+template <typename TVertex, typename... TAttributes>
+struct VertexLayout {
+	typedef TVertex VertexType;
+
+	// The distance in bytes between each vertex in the buffer
+	static constexpr GLsizei Stride         = sizeof(TVertex);
+	// The number of attributes in the layout
+	static constexpr size_t  AttributeCount = sizeof...(TAttributes);
+
+	/*
+	 * Enables and sets up all of the attributes on the currently bound VAO, reading from the currently bound GL_ARRAY_BUFFER
+	 * @param baseOffset The offset in bytes of the first vertex in the buffer
+	 */
+	static void Apply(size_t baseOffset = 0) {
+		(TAttributes::Apply(baseOffset), ...);
+	}
+};
+
+/*
+ * Gets the layout declared for a vertex type with VERTEX_LAYOUT
+ */
+template <typename TVertex>
+struct VertexLayoutOf;
+
+/*
+ * Declares the layout of a vertex type, this must be used at global scope after the vertex type is complete
+ * @param V The vertex type
+ * @param ... The VertexAttributes that make up the vertex
+ */
+#define VERTEX_LAYOUT(V, ...) \
+	template <> struct VertexLayoutOf<V> : public VertexLayout<V, __VA_ARGS__> { }
@@ -14,6 +14,7 @@ project "Toolkit"
         "Logging.cpp",
         "CerealGLM.h",
         "EnumToString.h",
+        "VertexLayout.h",
         "Sys.h",
         "Sys.cpp",
         "TTK\\**.cpp",
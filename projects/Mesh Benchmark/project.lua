@@ -0,0 +1,32 @@
+-- The benchmark runs the mesh pipeline from the Tutorial 10 project directly, rather than keeping
+-- its own copy of it. Paths here are relative to this file
+files {
+	"../Tutorial 10 - Starter/src/ObjLoader.h",
+	"../Tutorial 10 - Starter/src/ObjLoader.cpp",
+	"../Tutorial 10 - Starter/src/FileStream.h",
+	"../Tutorial 10 - Starter/src/FileStream.cpp",
+	"../Tutorial 10 - Starter/src/Mesh.h",
+	"../Tutorial 10 - Starter/src/Mesh.cpp",
+	"../Tutorial 10 - Starter/src/GeometryArena.h",
+	"../Tutorial 10 - Starter/src/GeometryArena.cpp",
+	"../Tutorial 10 - Starter/src/MappedFile.h",
+	"../Tutorial 10 - Starter/src/MappedFile.cpp",
+	"../Tutorial 10 - Starter/src/MeshCache.h",
+	"../Tutorial 10 - Starter/src/MeshCache.cpp",
+	"../Tutorial 10 - Starter/src/MeshOptimizer.h",
+	"../Tutorial 10 - Starter/src/MeshOptimizer.cpp",
+	"../Tutorial 10 - Starter/src/Meshlet.h",
+	"../Tutorial 10 - Starter/src/Meshlet.cpp",
+	"../Tutorial 10 - Starter/src/MeshSimplifier.h",
+	"../Tutorial 10 - Starter/src/MeshSimplifier.cpp",
+	"../Tutorial 10 - Starter/src/TangentGenerator.h",
+	"../Tutorial 10 - Starter/src/TangentGenerator.cpp",
+	"../Tutorial 10 - Starter/src/ThreadPool.h",
+	"../Tutorial 10 - Starter/src/ThreadPool.cpp",
+	"../Tutorial 10 - Starter/src/VertexHashTable.h",
+	"../Tutorial 10 - Starter/src/Utils.h"
+}
+
+includedirs {
+	"../Tutorial 10 - Starter/src"
+}
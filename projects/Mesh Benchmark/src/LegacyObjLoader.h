@@ -0,0 +1,18 @@
+/*
+	The original regex based OBJ loader from the Tutorial 10 project, kept around as a baseline to
+	benchmark the current loader against
+*/
+#pragma once
+
+#include "ObjLoader.h"
+
+class LegacyObjLoader {
+public:
+	/*
+	 * Loads a mesh from an obj file at the given file name, using std::regex and string streams
+	 * @param filename  The path to the file to load
+	 * @param baseColor The value to set for the vertex color attribute (default white)
+	 * @returns The mesh data loaded from the OBJ file
+	 */
+	static MeshData LoadObj(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f));
+};
@@ -0,0 +1,471 @@
+/*
+	Benchmarks the CPU side of the mesh pipeline on generated grids of 10K to 10M triangles: parsing OBJ files
+	(with every combination of UVs and normals, and against the original regex based loader for the smaller sizes),
+	vertex de-duplication, and each of the post-processing passes we run on loaded meshes. The results are printed
+	and written to a JSON file, so that runs from different commits can be compared
+	This does not need an OpenGL context, it only exercises the CPU side of the mesh pipeline
+
+	Usage: Mesh Benchmark [--sizes 10000,100000,1000000,10000000] [--iterations 3] [--json mesh_benchmark.json] [--label text]
+*/
+#include "Logging.h"
+#include "ObjLoader.h"
+#include "LegacyObjLoader.h"
+#include "ThreadPool.h"
+#include "VertexHashTable.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+
+#include <GLM/gtc/packing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The regex based loader takes minutes on the larger files, so we only compare against it up to this size
+static const size_t LegacyMaxTriangles   = 200000;
+// The simplifier works on the whole mesh at once and is the slowest of our passes, so it gets a limit too
+static const size_t SimplifyMaxTriangles = 1000000;
+
+/*
+ * Which attributes a generated OBJ file includes along with its positions
+ */
+struct ObjAttributes {
+	const char* Name;
+	bool        UVs;
+	bool        Normals;
+};
+
+static const ObjAttributes AttributeVariants[] = {
+	{ "pos_uv_normal", true,  true  },
+	{ "pos_uv",        true,  false },
+	{ "pos_normal",    false, true  },
+	{ "pos",           false, false }
+};
+
+/*
+ * Writes a grid of numSections x numSections quads to an OBJ file
+ * @param filename    The path of the file to write
+ * @param numSections The number of quads along each edge of the grid
+ * @param attributes  Which attributes to write along with the positions
+ * @returns The size of the file that was written, in bytes
+ */
+size_t WriteGridObj(const char* filename, int numSections, const ObjAttributes& attributes) {
+	std::ofstream file(filename, std::ios::binary);
+	int numEdgeVerts = numSections + 1;
+	char line[160];
+
+	file << "# Synthetic grid with " << (size_t)numSections * numSections * 2 << " triangles\n";
+	for (int ix = 0; ix < numEdgeVerts; ix++) {
+		for (int iy = 0; iy < numEdgeVerts; iy++) {
+			float x = ix / (float)numSections, y = iy / (float)numSections;
+			// Give the grid some height so our numbers aren't all trivial to parse
+			float z = 0.25f * sinf(x * 12.0f) * cosf(y * 7.0f);
+			int length = snprintf(line, sizeof(line), "v %f %f %f\n", x, y, z);
+			if (attributes.UVs)
+				length += snprintf(line + length, sizeof(line) - length, "vt %f %f\n", x, y);
+			if (attributes.Normals)
+				length += snprintf(line + length, sizeof(line) - length, "vn %f %f %f\n", 0.0f, 0.0f, 1.0f);
+			file.write(line, length);
+		}
+	}
+
+	// Every attribute shares the position's index, so we only need to pick the right face format
+	const char* corner =
+		attributes.UVs && attributes.Normals ? "%d/%d/%d" :
+		attributes.UVs                       ? "%d/%d"    :
+		attributes.Normals                   ? "%d//%d"   : "%d";
+	auto writeCorner = [&](int index, char* out, size_t size) {
+		return attributes.UVs && attributes.Normals ? snprintf(out, size, corner, index, index, index) :
+		       attributes.UVs || attributes.Normals ? snprintf(out, size, corner, index, index) :
+		                                              snprintf(out, size, corner, index);
+	};
+	auto writeFace = [&](int a, int b, int c) {
+		int length = snprintf(line, sizeof(line), "f ");
+		length += writeCorner(a, line + length, sizeof(line) - length);
+		line[length++] = ' ';
+		length += writeCorner(b, line + length, sizeof(line) - length);
+		line[length++] = ' ';
+		length += writeCorner(c, line + length, sizeof(line) - length);
+		line[length++] = '\n';
+		file.write(line, length);
+	};
+	for (int ix = 0; ix < numSections; ix++) {
+		for (int iy = 0; iy < numSections; iy++) {
+			// OBJ indices are 1 based
+			int p1 = (ix + 0) * numEdgeVerts + (iy + 0) + 1;
+			int p2 = (ix + 1) * numEdgeVerts + (iy + 0) + 1;
+			int p3 = (ix + 0) * numEdgeVerts + (iy + 1) + 1;
+			int p4 = (ix + 1) * numEdgeVerts + (iy + 1) + 1;
+			writeFace(p1, p2, p3);
+			writeFace(p3, p2, p4);
+		}
+	}
+	return static_cast<size_t>(file.tellp());
+}
+
+/*
+ * The times from running a measurement several times, in milliseconds
+ */
+struct Timing {
+	double BestMs   = 0.0;
+	double MedianMs = 0.0;
+};
+
+/*
+ * Runs func a number of times, returning the best and median times. Setup is run before each
+ * iteration but is not timed, so that passes which modify their input can start fresh each time
+ */
+template <typename Setup, typename Func>
+Timing Measure(int iterations, Setup&& setup, Func&& func) {
+	std::vector<double> times;
+	for (int ix = 0; ix < iterations; ix++) {
+		setup();
+		auto start = std::chrono::high_resolution_clock::now();
+		func();
+		auto stop = std::chrono::high_resolution_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	Timing result;
+	result.BestMs   = times.front();
+	result.MedianMs = times[times.size() / 2];
+	return result;
+}
+
+template <typename Func>
+Timing Measure(int iterations, Func&& func) {
+	return Measure(iterations, []() {}, func);
+}
+
+/*
+ * A single measurement in our results, along with any statistics the stage wants to report
+ */
+struct BenchmarkResult {
+	std::string Stage;
+	std::string Attributes;
+	size_t      Triangles;
+	// The size of the stage's input in megabytes, used to report throughput (0 if it doesn't apply)
+	double      Megabytes;
+	Timing      Time;
+	std::vector<std::pair<std::string, double>> Stats;
+};
+
+/*
+ * Collects our measurements, logging them as they come in, and writes them out as JSON at the end
+ */
+class BenchmarkReport {
+public:
+	BenchmarkResult& Add(const std::string& stage, const std::string& attributes, size_t triangles, double megabytes, const Timing& time) {
+		myResults.push_back({ stage, attributes, triangles, megabytes, time, {} });
+		if (megabytes > 0.0) {
+			LOG_INFO("\t{:<16} {:<14} {:10.2f} ms (median {:10.2f} ms) {:8.2f} MB/s", stage, attributes, time.BestMs, time.MedianMs,
+				megabytes / (time.BestMs / 1000.0));
+		} else {
+			LOG_INFO("\t{:<16} {:<14} {:10.2f} ms (median {:10.2f} ms) {:8.2f} M triangles/s", stage, attributes, time.BestMs, time.MedianMs,
+				triangles / (time.BestMs / 1000.0) / 1e6);
+		}
+		return myResults.back();
+	}
+
+	bool WriteJson(const char* filename, const std::string& label, int iterations) const {
+		FILE* file = fopen(filename, "w");
+		if (file == nullptr)
+			return false;
+
+		char timestamp[32];
+		time_t now = time(nullptr);
+		strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"label\": \"%s\",\n", __Escape(label).c_str());
+		fprintf(file, "  \"timestamp\": \"%s\",\n", timestamp);
+		fprintf(file, "  \"threads\": %zu,\n", ThreadPool::Global().GetThreadCount() + 1);
+		fprintf(file, "  \"iterations\": %d,\n", iterations);
+		// MSVC defines _DEBUG when building against the debug runtime
+		#ifdef _DEBUG
+		fprintf(file, "  \"config\": \"debug\",\n");
+		#else
+		fprintf(file, "  \"config\": \"release\",\n");
+		#endif
+		fprintf(file, "  \"results\": [\n");
+		for (size_t ix = 0; ix < myResults.size(); ix++) {
+			const BenchmarkResult& result = myResults[ix];
+			fprintf(file, "    { \"stage\": \"%s\", \"attributes\": \"%s\", \"triangles\": %zu, \"best_ms\": %.4f, \"median_ms\": %.4f",
+				result.Stage.c_str(), result.Attributes.c_str(), result.Triangles, result.Time.BestMs, result.Time.MedianMs);
+			if (result.Megabytes > 0.0)
+				fprintf(file, ", \"megabytes\": %.4f, \"mb_per_s\": %.4f", result.Megabytes, result.Megabytes / (result.Time.BestMs / 1000.0));
+			for (const auto& stat : result.Stats)
+				fprintf(file, ", \"%s\": %.6g", stat.first.c_str(), stat.second);
+			fprintf(file, " }%s\n", ix + 1 < myResults.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		fclose(file);
+		return true;
+	}
+
+private:
+	std::vector<BenchmarkResult> myResults;
+
+	static std::string __Escape(const std::string& text) {
+		std::string result;
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				result += '\\';
+			if (static_cast<unsigned char>(c) >= 0x20)
+				result += c;
+		}
+		return result;
+	}
+};
+
+// Hashes the contents of a mesh, so that we can check that our loaders agree without keeping every result around
+uint64_t HashMesh(const MeshData& mesh) {
+	uint64_t hash = MeshCache::HashBytes(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(Vertex));
+	return MeshCache::HashBytes(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t), hash);
+}
+
+/*
+ * Times loading a generated OBJ file with each of our loaders, and checks that they all produce the same mesh
+ * @returns False if any loader disagrees with the serial loader
+ */
+bool BenchmarkParse(BenchmarkReport& report, int iterations, int numSections, const ObjAttributes& attributes, MeshData& serial) {
+	const char* filename = "benchmark_grid.obj";
+	size_t triangles = (size_t)numSections * numSections * 2;
+	double megabytes = WriteGridObj(filename, numSections, attributes) / (1024.0 * 1024.0);
+
+	// We don't optimize or generate tangents here, so that we're only timing the loading and can compare against the legacy loader
+	ObjLoadOptions serialOptions = ObjLoadOptions();
+	serialOptions.Parallel = false;
+	serialOptions.Optimize = false;
+	serialOptions.GenerateTangents = false;
+	serialOptions.UseCache = false;
+	// Force a split even on small files, so that the chunk merging always gets exercised
+	ObjLoadOptions parallelOptions = serialOptions;
+	parallelOptions.Parallel = true;
+	parallelOptions.MinChunkBytes = 64 * 1024;
+	ObjLoadOptions streamOptions = serialOptions;
+	streamOptions.Streaming = true;
+
+	bool identical = true;
+	auto check = [&](const char* name, const MeshData& mesh, uint64_t expected) {
+		if (HashMesh(mesh) != expected) {
+			LOG_WARN("\t{} mesh data does not match the serial loader!", name);
+			identical = false;
+		}
+	};
+
+	report.Add("parse_serial", attributes.Name, triangles, megabytes,
+		Measure(iterations, [&]() { serial = ObjLoader::LoadObj(filename, glm::vec4(1.0f), serialOptions); }));
+	uint64_t expected = HashMesh(serial);
+
+	MeshData other;
+	report.Add("parse_parallel", attributes.Name, triangles, megabytes,
+		Measure(iterations, [&]() { other = ObjLoader::LoadObj(filename, glm::vec4(1.0f), parallelOptions); }));
+	check("Parallel loader", other, expected);
+	report.Add("parse_stream", attributes.Name, triangles, megabytes,
+		Measure(iterations, [&]() { other = ObjLoader::LoadObj(filename, glm::vec4(1.0f), streamOptions); }));
+	check("Streaming loader", other, expected);
+
+	// The legacy loader only understands faces with every attribute
+	if (triangles <= LegacyMaxTriangles && attributes.UVs && attributes.Normals) {
+		report.Add("parse_legacy", attributes.Name, triangles, megabytes,
+			Measure(iterations, [&]() { other = LegacyObjLoader::LoadObj(filename); }));
+		check("Legacy loader", other, expected);
+	}
+
+	std::remove(filename);
+	return identical;
+}
+
+/*
+ * Times de-duplicating the face vertices of a grid, using the original std::unordered_map with 21 bit packed
+ * keys, and the flat VertexHashTable with full 32 bit keys. We run it once with smooth shading, and once with
+ * a normal per quad, so that every position is shared by several unique vertices (like seams and hard edges)
+ */
+void BenchmarkDedup(BenchmarkReport& report, int iterations, int numSections) {
+	for (bool faceted : { false, true }) {
+		// Build the position/uv/normal index triple for every face vertex, in the same order as WriteGridObj
+		uint32_t numEdgeVerts = numSections + 1;
+		std::vector<glm::uvec3> keys;
+		keys.reserve((size_t)numSections * numSections * 6);
+		for (int ix = 0; ix < numSections; ix++) {
+			for (int iy = 0; iy < numSections; iy++) {
+				uint32_t p1 = (ix + 0) * numEdgeVerts + (iy + 0);
+				uint32_t p2 = (ix + 1) * numEdgeVerts + (iy + 0);
+				uint32_t p3 = (ix + 0) * numEdgeVerts + (iy + 1);
+				uint32_t p4 = (ix + 1) * numEdgeVerts + (iy + 1);
+				// Either every vertex shares one normal like a flat terrain, or each quad gets its own
+				uint32_t normal = faceted ? (uint32_t)(ix * numSections + iy) : 0;
+				for (uint32_t p : { p1, p2, p3, p3, p2, p4 })
+					keys.push_back(glm::uvec3(p, p, normal));
+			}
+		}
+		const char* attributes = faceted ? "pos_uv_normal_faceted" : "pos_uv_normal";
+		size_t faceCount = keys.size() / 3;
+		std::vector<uint32_t> indices(keys.size());
+		size_t legacyUnique = 0, flatUnique = 0;
+
+		report.Add("dedup_std_map", attributes, faceCount, 0.0, Measure(iterations, [&]() {
+			std::unordered_map<uint64_t, int> vectorCache;
+			uint64_t mask = 0b0'000000000000000000000'000000000000000000000'111111111111111111111;
+			for (size_t ix = 0; ix < keys.size(); ix++) {
+				const glm::uvec3& aSet = keys[ix];
+				uint64_t key = ((aSet[0] & mask) << 42) | ((aSet[1] & mask) << 21) | (aSet[2] & mask);
+				auto it = vectorCache.find(key);
+				if (it != vectorCache.end())
+					indices[ix] = it->second;
+				else {
+					indices[ix] = (uint32_t)vectorCache.size();
+					vectorCache[key] = indices[ix];
+				}
+			}
+			legacyUnique = vectorCache.size();
+		}));
+		BenchmarkResult& flat = report.Add("dedup_flat", attributes, faceCount, 0.0, Measure(iterations, [&]() {
+			VertexHashTable vectorCache(faceCount / 2);
+			for (size_t ix = 0; ix < keys.size(); ix++) {
+				bool isNew = false;
+				indices[ix] = vectorCache.FindOrInsert(keys[ix], (uint32_t)vectorCache.Size(), isNew);
+			}
+			flatUnique = vectorCache.Size();
+		}));
+		flat.Stats.push_back({ "unique_vertices", (double)flatUnique });
+		if (legacyUnique != flatUnique) {
+			LOG_WARN("\tunordered_map found {} unique vertices instead of {}, 21 bit keys have collided!", legacyUnique, flatUnique);
+		}
+	}
+}
+
+/*
+ * Times each of the passes we run on loaded meshes, on copies of the given mesh
+ */
+void BenchmarkPostProcess(BenchmarkReport& report, int iterations, const MeshData& mesh, const char* attributes) {
+	size_t triangles = mesh.Indices.size() / 3;
+	MeshData data;
+	auto reset = [&]() { data = mesh; };
+
+	MeshOptimizeReport optimizeReport;
+	BenchmarkResult& optimize = report.Add("optimize", attributes, triangles, 0.0,
+		Measure(iterations, reset, [&]() { optimizeReport = MeshOptimizer::Optimize(data); }));
+	optimize.Stats.push_back({ "acmr_before", optimizeReport.Before.ACMR });
+	optimize.Stats.push_back({ "acmr_after",  optimizeReport.After.ACMR });
+	optimize.Stats.push_back({ "atvr_before", optimizeReport.Before.ATVR });
+	optimize.Stats.push_back({ "atvr_after",  optimizeReport.After.ATVR });
+	// The rest of our passes expect an optimized mesh, like they get in the game
+	MeshData optimized = data;
+
+	TangentOptions serialTangents;
+	serialTangents.Parallel = false;
+	report.Add("tangents_serial", attributes, triangles, 0.0,
+		Measure(iterations, [&]() { data = optimized; }, [&]() { TangentGenerator::Generate(data, serialTangents); }));
+	BenchmarkResult& tangents = report.Add("tangents", attributes, triangles, 0.0,
+		Measure(iterations, [&]() { data = optimized; }, [&]() { TangentGenerator::Generate(data); }));
+	// Our tangents should always be unit length and perpendicular to their normals
+	float maxTangentError = 0.0f;
+	for (const Vertex& vertex : data.Vertices) {
+		glm::vec3 tangent = glm::vec3(vertex.Tangent);
+		maxTangentError = glm::max(maxTangentError, glm::max(glm::abs(glm::dot(tangent, vertex.Normal)), glm::abs(glm::length(tangent) - 1.0f)));
+	}
+	tangents.Stats.push_back({ "max_tangent_error", maxTangentError });
+	optimized = data;
+
+	std::vector<PackedVertex> packed;
+	BenchmarkResult& pack = report.Add("pack_vertices", attributes, triangles, 0.0,
+		Measure(iterations, [&]() { packed = PackedVertex::Pack(optimized.Vertices); }));
+	float maxError = 0.0f;
+	for (size_t ix = 0; ix < packed.size(); ix++) {
+		glm::vec3 position = glm::vec3(
+			glm::unpackHalf1x16(packed[ix].Position[0]),
+			glm::unpackHalf1x16(packed[ix].Position[1]),
+			glm::unpackHalf1x16(packed[ix].Position[2]));
+		maxError = glm::max(maxError, glm::length(position - optimized.Vertices[ix].Position));
+	}
+	pack.Stats.push_back({ "full_mb",   optimized.Vertices.size() * sizeof(Vertex) / (1024.0 * 1024.0) });
+	pack.Stats.push_back({ "packed_mb", packed.size() * sizeof(PackedVertex) / (1024.0 * 1024.0) });
+	pack.Stats.push_back({ "max_position_error", maxError });
+	packed = std::vector<PackedVertex>();
+
+	std::vector<Meshlet> meshlets;
+	BenchmarkResult& meshletResult = report.Add("build_meshlets", attributes, triangles, 0.0,
+		Measure(iterations, [&]() { data = optimized; }, [&]() { meshlets = MeshOptimizer::BuildMeshlets(data); }));
+	meshletResult.Stats.push_back({ "meshlets", (double)meshlets.size() });
+
+	if (triangles <= SimplifyMaxTriangles) {
+		std::vector<MeshLodLevel> levels;
+		BenchmarkResult& simplify = report.Add("build_lods", attributes, triangles, 0.0,
+			Measure(iterations, [&]() { levels = MeshSimplifier::BuildLodChain(optimized); }));
+		simplify.Stats.push_back({ "levels", (double)levels.size() });
+		simplify.Stats.push_back({ "last_level_triangles", (double)(levels.back().Data.Indices.size() / 3) });
+	}
+}
+
+int main(int argc, char** argv) {
+	Logger::Init();
+
+	std::vector<size_t> sizes = { 10000, 100000, 1000000, 10000000 };
+	int iterations = 3;
+	std::string jsonFile = "mesh_benchmark.json";
+	std::string label;
+	for (int ix = 1; ix < argc; ix++) {
+		std::string arg = argv[ix];
+		const char* value = ix + 1 < argc ? argv[ix + 1] : nullptr;
+		if (arg == "--sizes" && value != nullptr) {
+			sizes.clear();
+			std::string list = value;
+			for (size_t start = 0; start < list.size(); ) {
+				size_t comma = std::min(list.find(',', start), list.size());
+				sizes.push_back(strtoull(list.substr(start, comma - start).c_str(), nullptr, 10));
+				start = comma + 1;
+			}
+			ix++;
+		}
+		else if (arg == "--iterations" && value != nullptr) { iterations = std::max(1, atoi(value)); ix++; }
+		else if (arg == "--json" && value != nullptr)       { jsonFile = value; ix++; }
+		else if (arg == "--label" && value != nullptr)      { label = value; ix++; }
+		else {
+			LOG_ERROR("Usage: {} [--sizes 10000,100000,...] [--iterations 3] [--json mesh_benchmark.json] [--label text]", argv[0]);
+			Logger::Uninitialize();
+			return 2;
+		}
+	}
+
+	BenchmarkReport report;
+	bool identical = true;
+	for (size_t size : sizes) {
+		// Our grids are made of quads, so we take the closest size that we can make
+		int numSections = std::max(1, (int)round(sqrt(size / 2.0)));
+		size_t triangles = (size_t)numSections * numSections * 2;
+		LOG_INFO("{} triangles ({}x{} grid):", triangles, numSections, numSections);
+
+		MeshData full;
+		for (const ObjAttributes& attributes : AttributeVariants) {
+			MeshData mesh;
+			identical &= BenchmarkParse(report, iterations, numSections, attributes, mesh);
+			if (attributes.UVs && attributes.Normals)
+				full = std::move(mesh);
+		}
+		BenchmarkDedup(report, iterations, numSections);
+		BenchmarkPostProcess(report, iterations, full, AttributeVariants[0].Name);
+	}
+
+	if (report.WriteJson(jsonFile.c_str(), label, iterations)) {
+		LOG_INFO("Wrote results to {}", jsonFile);
+	} else {
+		LOG_ERROR("Failed to write results to {}", jsonFile);
+	}
+	if (!identical) {
+		LOG_WARN("Our loaders did not all produce the same mesh data!");
+	}
+
+	Logger::Uninitialize();
+	return identical ? 0 : 1;
+}
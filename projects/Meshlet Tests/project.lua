@@ -0,0 +1,10 @@
+-- The tests run the meshlet culler from the Tutorial 10 project directly, rather than keeping their own copy
+-- of it. Paths here are relative to this file
+files {
+	"../Tutorial 10 - Starter/src/Meshlet.h",
+	"../Tutorial 10 - Starter/src/Meshlet.cpp"
+}
+
+includedirs {
+	"../Tutorial 10 - Starter/src"
+}
@@ -0,0 +1,144 @@
+/*
+	Tests for MeshletCuller, using hand made meshlets that we know the answers for. Each view checks meshlets that
+	are outside of the frustum, facing away from the camera, and visible, for both perspective and orthographic
+	cameras. This does not need an OpenGL context
+
+	Usage: Meshlet Tests
+	Returns 0 if every test passed
+*/
+#include "Meshlet.h"
+
+#include <GLM/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <vector>
+
+static int Failures = 0;
+
+// Logs and counts a failed check, without stopping the rest of the tests
+#define CHECK(x) { if (!(x)) { printf("  FAILED %s (line %d)\n", #x, __LINE__); Failures++; } }
+
+/*
+ * Makes a meshlet of 10 triangles at the given index offset
+ * @param offset The first index of the meshlet
+ * @param center The center of the meshlet's bounding sphere
+ * @param axis   The direction the meshlet's triangles face
+ * @param cutoff The sine of the largest angle a triangle strays from the axis, 1 to never be back facing
+ */
+static Meshlet MakeMeshlet(uint32_t offset, const glm::vec3& center, const glm::vec3& axis, float cutoff) {
+	Meshlet result;
+	result.IndexOffset = offset;
+	result.IndexCount  = 30;
+	result.VertexCount = 12;
+	result.Center      = center;
+	result.Radius      = 1.0f;
+	result.ConeAxis    = glm::normalize(axis);
+	result.ConeCutoff  = cutoff;
+	return result;
+}
+
+// A camera 10 units up the Z axis, looking back at the origin
+static glm::mat4 MakeView() {
+	return glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/*
+ * The same set of cases for any camera looking down -Z at the origin that can see at least 3 units to either side
+ * of it. The meshlets are laid out back to back, so that we can also check how visible runs get merged
+ */
+static void TestView(const MeshletCullView& view) {
+	const glm::vec3 toCamera = glm::vec3(0.0f, 0.0f, 1.0f);
+	std::vector<Meshlet> meshlets = {
+		MakeMeshlet(0,   glm::vec3(0.0f),               toCamera,  0.5f), // Visible, facing the camera
+		MakeMeshlet(30,  glm::vec3(2.0f, 0.0f, 0.0f),   -toCamera, 1.0f), // Visible, the cone is too wide to cull
+		MakeMeshlet(60,  glm::vec3(0.0f, 2.0f, 0.0f),   -toCamera, 0.5f), // Facing away from the camera
+		MakeMeshlet(90,  glm::vec3(-2.0f, 0.0f, 0.0f),  toCamera,  0.5f), // Visible
+		MakeMeshlet(120, glm::vec3(50.0f, 0.0f, 0.0f),  toCamera,  0.5f), // Off to the right
+		MakeMeshlet(150, glm::vec3(0.0f, 0.0f, 20.0f),  toCamera,  0.5f), // Behind the camera
+		MakeMeshlet(180, glm::vec3(0.0f, 0.0f, -500.0f), toCamera, 0.5f)  // Past the far plane
+	};
+
+	std::vector<MeshletRange> ranges;
+	MeshletCullStats stats;
+	size_t visible = MeshletCuller::Cull(meshlets, view, ranges, &stats);
+
+	CHECK(visible == 3);
+	CHECK(stats.Total == meshlets.size());
+	CHECK(stats.Frustum == 3);
+	CHECK(stats.Backface == 1);
+	// The first two meshlets are drawn as one run, the back facing one splits off the third
+	CHECK(ranges.size() == 2);
+	if (ranges.size() == 2) {
+		CHECK(ranges[0].IndexOffset == 0 && ranges[0].IndexCount == 60);
+		CHECK(ranges[1].IndexOffset == 90 && ranges[1].IndexCount == 30);
+	}
+
+	// Stats add up across calls, and the ranges are replaced instead of appended to
+	MeshletCuller::Cull(meshlets, view, ranges, &stats);
+	CHECK(stats.Total == meshlets.size() * 2);
+	CHECK(ranges.size() == 2);
+}
+
+static void TestPerspective() {
+	printf("Perspective\n");
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+	MeshletCullView view = MeshletCullView::Create(glm::mat4(1.0f), MakeView(), projection);
+	CHECK(!view.IsOrthographic);
+	CHECK(glm::length(view.CameraPosition - glm::vec3(0.0f, 0.0f, 10.0f)) < 1e-4f);
+	TestView(view);
+
+	// A meshlet off to the side, whose triangles lean slightly away along the view direction but turn towards the
+	// camera's position. A perspective camera sees their front faces, so it must be drawn
+	std::vector<Meshlet> meshlets = { MakeMeshlet(0, glm::vec3(4.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, -0.2f), 0.5f) };
+	std::vector<MeshletRange> ranges;
+	CHECK(MeshletCuller::Cull(meshlets, view, ranges) == 1);
+}
+
+static void TestOrthographic() {
+	printf("Orthographic\n");
+	glm::mat4 projection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
+	MeshletCullView view = MeshletCullView::Create(glm::mat4(1.0f), MakeView(), projection);
+	CHECK(view.IsOrthographic);
+	CHECK(glm::length(view.ViewDirection - glm::vec3(0.0f, 0.0f, -1.0f)) < 1e-4f);
+	TestView(view);
+
+	// The edges of an orthographic frustum don't spread out, so spheres just past them are culled at any depth
+	std::vector<Meshlet> meshlets = {
+		MakeMeshlet(0,  glm::vec3(4.5f, 0.0f, -50.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.5f), // Overlaps the right edge
+		MakeMeshlet(30, glm::vec3(6.5f, 0.0f, -50.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.5f)  // Just past it
+	};
+	std::vector<MeshletRange> ranges;
+	MeshletCullStats stats;
+	CHECK(MeshletCuller::Cull(meshlets, view, ranges, &stats) == 1);
+	CHECK(stats.Frustum == 1);
+}
+
+static void TestModelSpace() {
+	printf("Model space\n");
+	// The culler works in the mesh's model space, so moving the mesh has to move its meshlets with it
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(100.0f, 0.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+	MeshletCullView view = MeshletCullView::Create(model, MakeView(), projection);
+
+	std::vector<Meshlet> meshlets = {
+		MakeMeshlet(0,  glm::vec3(-100.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), 0.5f), // At the world origin
+		MakeMeshlet(30, glm::vec3(0.0f),                glm::vec3(0.0f, 0.0f, 1.0f), 0.5f)  // 100 units to the right
+	};
+	std::vector<MeshletRange> ranges;
+	MeshletCullStats stats;
+	CHECK(MeshletCuller::Cull(meshlets, view, ranges, &stats) == 1);
+	CHECK(stats.Frustum == 1);
+	CHECK(ranges.size() == 1 && ranges[0].IndexOffset == 0);
+}
+
+int main() {
+	TestPerspective();
+	TestOrthographic();
+	TestModelSpace();
+
+	if (Failures > 0)
+		printf("%d checks failed\n", Failures);
+	else
+		printf("All checks passed\n");
+	return Failures > 0 ? 1 : 0;
+}
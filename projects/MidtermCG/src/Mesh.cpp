@@ -3,46 +3,69 @@
 #include <vector>
 #include <stdio.h>
 #include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <stdexcept>
+#include <unordered_map>
 #include <Logging.h>
 
-#define BUFFER_OFFSET(i) ((char*)0 + (i)) //cheers emilian
 
-
-struct Face
+// The position, UV and normal indices of a single face vertex (0-based, -1 if not provided)
+struct FaceVertex
 {
-	Face()
-	{
-		for(int i = 0 ; i < 3 ; i++)
-		{
-			vertices[i] = 0;
-			normals[i]  = 0;
-			uvs[i]		= 0;
-		}
-	}
-
-	Face(unsigned int v1, unsigned int v2, unsigned int v3, 
-		unsigned int u1, unsigned int u2, unsigned int u3,
-		unsigned int n1, unsigned int n2, unsigned int n3)
-	{
-		vertices[0] = v1;
-		 normals[0]	= n1;
-		     uvs[0] = u1;
+	int vertex = -1;
+	int uv     = -1;
+	int normal = -1;
 
-		vertices[1] = v2;
-		 normals[1] = n2;
-		     uvs[1] = u2;
+	bool operator ==(const FaceVertex& other) const {
+		return vertex == other.vertex && uv == other.uv && normal == other.normal;
+	}
+};
 
-		vertices[2] = v3;
-		 normals[2] = n3;
-		     uvs[2] = u3;
+// Lets us use FaceVertex as a key in an unordered_map
+struct FaceVertexHash
+{
+	size_t operator()(const FaceVertex& key) const {
+		size_t hash = std::hash<int>()(key.vertex);
+		hash ^= std::hash<int>()(key.uv)     + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		hash ^= std::hash<int>()(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		return hash;
 	}
-	
-	unsigned int vertices[3];
-	unsigned int normals[3];
-	unsigned int uvs[3];
 };
 
+// Converts a 1-based (or negative, relative) OBJ index into a 0-based index, -1 if there was no index
+static int resolveIndex(long index, size_t count)
+{
+	if (index > 0)
+		return (int)index - 1;
+	if (index < 0)
+		return (int)count + (int)index;
+	return -1;
+}
+
+// Reads a face vertex token in the form v, v/t, v//n or v/t/n, returns false if there was no vertex to read
+static bool parseFaceVertex(const char*& cursor, size_t numVertices, size_t numUvs, size_t numNormals, FaceVertex& result)
+{
+	char* end = nullptr;
+	long raw[3] = { 0, 0, 0 };
+	raw[0] = std::strtol(cursor, &end, 10);
+	if (end == cursor)
+		return false;
+	cursor = end;
+	for (int i = 1; i < 3 && *cursor == '/'; i++)
+	{
+		cursor++;
+		raw[i] = std::strtol(cursor, &end, 10);
+		cursor = end;
+	}
 
+	result.vertex = resolveIndex(raw[0], numVertices);
+	result.uv     = resolveIndex(raw[1], numUvs);
+	result.normal = resolveIndex(raw[2], numNormals);
+	return true;
+}
 
 Mesh::Mesh(Vertex* vertices, size_t numVerts, uint32_t* faceIndices, size_t numIndices)
 {
@@ -55,23 +78,12 @@ Mesh::Mesh(Vertex* vertices, size_t numVerts, uint32_t* faceIndices, size_t numI
 	glCreateBuffers(2, myBuffers);
 	// Bind and buffer our vertex data
 	glBindBuffer(GL_ARRAY_BUFFER, myBuffers[0]);
-	glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, numVerts * VertexLayoutOf<Vertex>::Stride, vertices, GL_STATIC_DRAW);
 	// Bind and buffer our index data
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, myBuffers[1]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(uint32_t), faceIndices, GL_STATIC_DRAW);
-	// Get a null vertex to get member offsets from
-	Vertex* vert = nullptr;
-
-	// Enable vertex attribute 0
-	glEnableVertexAttribArray(0);
-	// Our first attribute is 3 floats, the distance between
-	// them is the size of our vertex, and they will map to the position in our vertices
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), &(vert->Position));
-	// Enable vertex attribute 1
-	glEnableVertexAttribArray(1);
-	// Our second attribute is 4 floats, the distance between
-	// them is the size of our vertex, and they will map to the color in our vertices
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(Vertex), &(vert->Color));
+	// Set up our position and color attributes
+	VertexLayoutOf<Vertex>::Apply();
 	// Unbind our VAO
 	glBindVertexArray(0);
 }
@@ -95,6 +107,8 @@ Mesh::~Mesh() {
 
 bool Mesh::loadObj(const std::string& objPath)
 {
+	auto startTime = std::chrono::high_resolution_clock::now();
+
 	std::ifstream input;
 	input.open(objPath);
 
@@ -104,40 +118,31 @@ bool Mesh::loadObj(const std::string& objPath)
 		return false;
 	}
 
-	char inputString[128];
-
 	//unique data
 	std::vector<glm::vec3> vertexData;
 	std::vector<glm::vec3> normalData;
 	std::vector<glm::vec2> uvData;
-	//index data / face data
-	std::vector<Face> faceData;
-	//OpenGl ready data
-	std::vector<float> unPackedVertexData;
-	std::vector<float> unPackedNormalData;
-	std::vector<float> unPackedTextureData;
-
-	while(!input.eof())
+	//OpenGl ready data, every unique position/uv/normal combination is stored once and referenced by index
+	std::vector<ObjVertex> meshVertices;
+	std::vector<uint32_t>  meshIndices;
+	std::unordered_map<FaceVertex, uint32_t, FaceVertexHash> vertexCache;
+
+	std::string line;
+	while(std::getline(input, line))
 	{
-		input.getline(inputString, 128);
-		
-		//Comments
-		if (std::strstr(inputString,"#") != nullptr)
-		{
-			continue;
-		}
-		if(std::strstr(inputString,"o") != nullptr)
-		{
-			continue;
-		}
+		// We look at the first token on the line to work out what it is, anything we don't know
+		// (comments, objects, groups, materials) is skipped
+		const char* cursor = line.c_str();
+		while (*cursor == ' ' || *cursor == '\t')
+			cursor++;
 		
 		/////////////////////Normal Data////////////////////////
-		else if (std::strstr(inputString, "vn") != nullptr)
+		if (std::strncmp(cursor, "vn ", 3) == 0)
 		{
 			glm::vec3 temp;
 			
 			//using sscanf returns the number of matches in the line to the format we provided
-			unsigned int matches = std::sscanf(inputString, "vn %f %f %f", &temp.x, &temp.y, &temp.z);
+			unsigned int matches = std::sscanf(cursor, "vn %f %f %f", &temp.x, &temp.y, &temp.z);
 
 			//use matches to make sure our data is all loaded properly
 			if (matches != 3)
@@ -148,12 +153,12 @@ bool Mesh::loadObj(const std::string& objPath)
 		}
 		
 		/////////////////////Texture Data////////////////////////
-		else if (std::strstr(inputString, "vt") != nullptr)
+		else if (std::strncmp(cursor, "vt ", 3) == 0)
 		{
 			glm::vec2 temp;
 			
 			//using sscanf returns the number of matches in the line to the format we provided
-			unsigned int matches = std::sscanf(inputString, "vt %f %f", &temp.x, &temp.y);
+			unsigned int matches = std::sscanf(cursor, "vt %f %f", &temp.x, &temp.y);
 
 			//use matches to make sure our data is all loaded properly
 			if(matches != 2)
@@ -164,109 +169,127 @@ bool Mesh::loadObj(const std::string& objPath)
 		}
 		
 		/////////////////////Vertex Data////////////////////////
-		else if(std::strstr(inputString, "v") != nullptr)
+		else if (std::strncmp(cursor, "v ", 2) == 0)
 		{
 			glm::vec3 temp;
 
 			//using sscanf returns the number of matches in the line to the format we provided
-			unsigned int matches = std::sscanf(inputString, "v %f %f %f", &temp.x, &temp.y, &temp.z);
+			unsigned int matches = std::sscanf(cursor, "v %f %f %f", &temp.x, &temp.y, &temp.z);
 			//use matches to make sure our data is all loaded properly
 			if (matches != 3)
-				throw std::runtime_error("can't load texture data");
+				throw std::runtime_error("can't load vertex data");
 			
 			//push back our loaded data
 			vertexData.push_back(temp);
 		}
 		
 		///////////////////////Face Data/////////////////////////
-		else if (std::strstr(inputString, "f") != nullptr)
+		else if (std::strncmp(cursor, "f ", 2) == 0)
 		{
-			Face temp;
-
-			//using sscanf returns the number of matches in the line to the format we provided
-			unsigned int matches = std::sscanf(inputString, "f %u/%u/%u %u/%u/%u %u/%u/%u", 
-				&temp.vertices[0], &temp.uvs[0], &temp.normals[0], 
-				&temp.vertices[1], &temp.uvs[1], &temp.normals[1],
-				&temp.vertices[2], &temp.uvs[2], &temp.normals[2]);
+			cursor += 2;
+
+			// Polygons with more than 3 vertices are split into a fan of triangles around the first vertex
+			uint32_t corners[3];
+			int numCorners = 0;
+			FaceVertex key;
+			while (true)
+			{
+				while (*cursor == ' ' || *cursor == '\t')
+					cursor++;
+				if (!parseFaceVertex(cursor, vertexData.size(), uvData.size(), normalData.size(), key))
+					break;
+				if (key.vertex < 0 || key.vertex >= (int)vertexData.size() || key.uv >= (int)uvData.size() || key.normal >= (int)normalData.size())
+					throw std::runtime_error("can't load face data");
+
+				// Find the vertex we already made for this combination of indices, or make a new one
+				auto it = vertexCache.find(key);
+				uint32_t index;
+				if (it != vertexCache.end())
+				{
+					index = it->second;
+				}
+				else
+				{
+					ObjVertex vertex;
+					vertex.Position = vertexData[key.vertex];
+					vertex.UV       = key.uv     >= 0 ? uvData[key.uv]         : glm::vec2(0.0f);
+					vertex.Normal   = key.normal >= 0 ? normalData[key.normal] : glm::vec3(0.0f);
+					index = (uint32_t)meshVertices.size();
+					meshVertices.push_back(vertex);
+					vertexCache.emplace(key, index);
+				}
+
+				if (numCorners >= 3)
+					corners[1] = corners[2];
+				corners[numCorners < 3 ? numCorners : 2] = index;
+				numCorners++;
+
+				if (numCorners >= 3)
+				{
+					meshIndices.push_back(corners[0]);
+					meshIndices.push_back(corners[1]);
+					meshIndices.push_back(corners[2]);
+				}
+			}
 			 
-			//use matches to make sure our data is all loaded properly
-			if (matches != 9)
+			//use our corner count to make sure our data is all loaded properly
+			if (numCorners < 3)
 				throw std::runtime_error("can't load face data");
-			 
-			//push back our loaded data
-			faceData.push_back(temp);
 		}
 
 	}
 		input.close();
 
-	//unpacking data
-	for(int i = 0 ; i <faceData.size(); i++)
-	{
-		for(int j = 0 ; j < 3 ; j++)
-		{
-			unPackedVertexData.push_back(vertexData[faceData[i].vertices[j] - 1].x);
-			unPackedVertexData.push_back(vertexData[faceData[i].vertices[j] - 1].y);
-			unPackedVertexData.push_back(vertexData[faceData[i].vertices[j] - 1].z);
+	// Get rid of anything we had loaded before
+	if (myVao != 0)
+		unloadObj();
 
-			unPackedVertexData.push_back(uvData[faceData[i].uvs[j] - 1].x);
-			unPackedVertexData.push_back(uvData[faceData[i].uvs[j] - 1].y);
-			
-			unPackedVertexData.push_back(normalData[faceData[i].normals[j] - 1].x);
-			unPackedVertexData.push_back(normalData[faceData[i].normals[j] - 1].y);
-			unPackedVertexData.push_back(normalData[faceData[i].normals[j] - 1].z);
-		}
-	}
-
-	numFaces = faceData.size();
-	numVertices = numFaces * 3;
+	numFaces = (unsigned int)(meshIndices.size() / 3);
+	numVertices = (unsigned int)meshVertices.size();
+	myVertexCount = meshVertices.size();
+	myIndexCount = meshIndices.size();
 
 	//Send data to openGl
-	glGenVertexArrays(1, &myVao);
-	
+	glCreateVertexArrays(1, &myVao);
 	glBindVertexArray(myVao);
-	glGenBuffers(1, &myVBO);
-	
-	glBindBuffer(GL_ARRAY_BUFFER, myVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float)* unPackedVertexData.size(), unPackedVertexData.data(), GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(0); //Vertex 
-	glVertexAttribPointer((GLuint)0, 3, GL_FLOAT, false, sizeof(float) * 8, BUFFER_OFFSET(0));
-
-	glEnableVertexAttribArray(1);//Uvs
-	glVertexAttribPointer((GLuint)1, 2, GL_FLOAT, false, sizeof(float) * 8, BUFFER_OFFSET(12));
+	glCreateBuffers(2, myBuffers);
 	
-	glEnableVertexAttribArray(2);//Normals 
-	glVertexAttribPointer((GLuint)2, 3, GL_FLOAT, false, sizeof(float) * 8, BUFFER_OFFSET(20));
+	glBindBuffer(GL_ARRAY_BUFFER, myBuffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ObjVertex) * meshVertices.size(), meshVertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, myBuffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * meshIndices.size(), meshIndices.data(), GL_STATIC_DRAW);
 
+	// Our vertices are laid out as an ObjVertex (position, UV, normal)
+	VertexLayoutOf<ObjVertex>::Apply();
 
-	//cleanup
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//cleanup, the element buffer stays bound to the VAO
 	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	vertexData.clear();
-	uvData.clear();
-	normalData.clear();
-	faceData.clear();
-	unPackedVertexData.clear();
-	unPackedTextureData.clear();
-	unPackedNormalData.clear();
+	// Compare against what we would have uploaded if we had stored every face vertex separately
+	double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	size_t indexedBytes = sizeof(ObjVertex) * meshVertices.size() + sizeof(uint32_t) * meshIndices.size();
+	size_t unindexedBytes = sizeof(ObjVertex) * meshIndices.size();
+	LOG_INFO("Loaded '{}' in {:.2f} ms: {} faces, {} unique vertices, {:.1f} KB of buffers (unindexed would be {:.1f} KB)",
+		objPath, loadMs, numFaces, numVertices, indexedBytes / 1024.0, unindexedBytes / 1024.0);
 
 	return true;
 }
 
 void Mesh::unloadObj()
 {
-	glDeleteBuffers(1, &myVBO);
+	glDeleteBuffers(2, myBuffers);
 
 	glDeleteVertexArrays(1, &myVao);
 
-	myVBO = 0;
+	myBuffers[0] = myBuffers[1] = 0;
 
 	myVao = 0;
 
 	numFaces = 0;
 	numVertices = 0;
+	myVertexCount = 0;
+	myIndexCount = 0;
 }
 
 unsigned int Mesh::getNumFaces() const
@@ -283,6 +306,5 @@ void Mesh::Draw() {
 	// Bind the mesh
 	glBindVertexArray(myVao); 
 	// Draw all of our vertices as triangles, our indexes are unsigned ints (uint32_t)
-	//glDrawArrays(GL_TRIANGLES, 0, numVertices);
-	glDrawElements(GL_TRIANGLES, myIndexCount, GL_UNSIGNED_INT, nullptr);
+	glDrawElements(GL_TRIANGLES, (GLsizei)myIndexCount, GL_UNSIGNED_INT, nullptr);
 }
@@ -4,10 +4,27 @@
 #include <cstdint> // Needed for uint32_t
 #include <memory> // Needed for smart pointers
 #include <string> // For filepath
+#include <VertexLayout.h>
 struct Vertex {
 	glm::vec3 Position;
 	glm::vec4 Color;
 };
+VERTEX_LAYOUT(Vertex,
+	VertexAttribute<&Vertex::Position, 0>,
+	VertexAttribute<&Vertex::Color,    1>
+);
+
+// The interleaved vertex format that loadObj builds
+struct ObjVertex {
+	glm::vec3 Position;
+	glm::vec2 UV;
+	glm::vec3 Normal;
+};
+VERTEX_LAYOUT(ObjVertex,
+	VertexAttribute<&ObjVertex::Position, 0>,
+	VertexAttribute<&ObjVertex::UV,       1>,
+	VertexAttribute<&ObjVertex::Normal,   2>
+);
 
 class Mesh {
 public:
@@ -19,11 +36,12 @@ public:
 	Mesh();
 	~Mesh();
 	 
-	// Load an obj file
+	// Load an obj file into an indexed mesh, where each unique position/uv/normal combination is only stored once
 	bool loadObj(const std::string &objPath);
 	void unloadObj();
 
 	unsigned int getNumFaces() const;
+	// Gets the number of unique vertices in the mesh
 	unsigned int getNumVertices() const; 
 
 	//model matrix
@@ -33,13 +51,12 @@ public:
 	void Draw();
 private:
 	// Our GL handle for the Vertex Array Object
-	GLuint myVao;
+	GLuint myVao = 0;
 	// 0 is vertices, 1 is indices
-	GLuint myBuffers[2];
+	GLuint myBuffers[2] = { 0, 0 };
 
-	GLuint myVBO;
 	// The number of vertices and indices in this mesh
-	size_t myVertexCount, myIndexCount;
+	size_t myVertexCount = 0, myIndexCount = 0;
 
 	unsigned int numFaces = 0;
 	unsigned int numVertices = 0;
@@ -2,12 +2,12 @@
 layout(location = 0) in vec3 inPosition;
 layout(location = 0) out vec3 outTexCoords;
 
-uniform mat4 a_View;
-uniform mat4 a_Projection;
+#include "include/scene-uniforms.glsl"
 
 void main()
 {
 	outTexCoords = normalize(inPosition);
-	vec4 outPos = a_Projection * a_View * vec4(inPosition, 1.0);
+	// The skybox is infinitely far away, so it ignores the camera's position
+	vec4 outPos = a_Projection * mat4(mat3(a_View)) * vec4(inPosition, 1.0);
 	gl_Position = outPos.xyww;
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 450
+// Drawn in place of shaders that are still being compiled, so this is kept as small as we can make it
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	// A little bit of light from above, so that shapes can still be made out
+	float light = 0.6 + 0.4 * max(normalize(inNormal).z, 0.0);
+	outColor = vec4(inColor.rgb * light, 1.0);
+}
@@ -0,0 +1,20 @@
+// Blends up to 3 albedo textures together with per-vertex weights. Variants can set ALBEDO_COUNT to sample fewer
+// of them, ex: ALBEDO_COUNT 1 for materials that only ever use the first
+#ifndef ALBEDO_COUNT
+#define ALBEDO_COUNT 3
+#endif
+
+uniform sampler2D s_Albedos[3];
+
+vec4 SampleAlbedo(vec2 uv, vec3 texWeights) {
+#if ALBEDO_COUNT == 1
+	return texture(s_Albedos[0], uv);
+#else
+	float totalWeight = dot(texWeights, vec3(1, 1, 1));
+	vec3 weights = texWeights / totalWeight;
+	vec4 albedo = vec4(0);
+	for (int ix = 0; ix < ALBEDO_COUNT; ix++)
+		albedo += texture(s_Albedos[ix], uv) * weights[ix];
+	return albedo;
+#endif
+}
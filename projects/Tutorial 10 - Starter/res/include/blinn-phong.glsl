@@ -0,0 +1,50 @@
+// A single point light with Blinn-Phong shading, shared by our lit fragment shaders
+#include "scene-uniforms.glsl"
+
+uniform vec3  a_AmbientColor;
+uniform float a_AmbientPower;
+
+uniform vec3  a_LightPos;
+uniform vec3  a_LightColor;
+uniform float a_LightShininess;
+uniform float a_LightAttenuation;
+
+// Gets the light reaching a point on a surface, multiply this by the surface's color
+vec3 BlinnPhong(vec3 worldPos, vec3 normal) {
+	// Re-normalize our input, so that it is always length 1
+	vec3 norm = normalize(normal);
+	// Determine the direction from the position to the light
+	vec3 toLight = a_LightPos - worldPos;
+	// Determine the distance to the light (used for attenuation later)
+	float distToLight = length(toLight);
+	// Normalize our toLight vector
+	toLight = normalize(toLight);
+
+	// Determine the direction between the camera and the pixel
+	vec3 viewDir = normalize(a_CameraPos - worldPos);
+
+	// Calculate the halfway vector between the direction to the light and the direction to the eye
+	vec3 halfDir = normalize(toLight + viewDir);
+
+	// Our specular power is the angle between the the normal and the half vector, raised
+	// to the power of the light's shininess
+	float specPower = pow(max(dot(norm, halfDir), 0.0), a_LightShininess);
+
+	// Finally, we can calculate the actual specular factor
+	vec3 specOut = specPower * a_LightColor;
+
+	// Calculate our diffuse factor, this is essentially the angle between
+	// the surface and the light
+	float diffuseFactor = max(dot(norm, toLight), 0);
+	// Calculate our diffuse output
+	vec3  diffuseOut = diffuseFactor * a_LightColor;
+
+	// Our ambient is simply the color times the ambient power
+	vec3 ambientOut = a_AmbientColor * a_AmbientPower;
+
+	// We will use a modified form of distance squared attenuation, which will avoid divide
+	// by zero errors and allow us to control the light's attenuation via a uniform
+	float attenuation = 1.0 / (1.0 + a_LightAttenuation * pow(distToLight, 2));
+
+	return ambientOut + attenuation * (diffuseOut + specOut);
+}
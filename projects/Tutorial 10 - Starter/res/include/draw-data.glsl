@@ -0,0 +1,9 @@
+// Our transforms come from the DrawBatcher, one set per draw in the batch. Shaders that include this need
+// #extension GL_ARB_shader_draw_parameters : require to find their draw with gl_DrawIDARB
+struct DrawObject {
+	mat4 Model;
+	mat4 NormalMatrix;
+};
+layout(std430, binding = 0) readonly buffer DrawData {
+	DrawObject a_Draws[];
+};
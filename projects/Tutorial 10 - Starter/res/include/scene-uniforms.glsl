@@ -0,0 +1,15 @@
+// The uniform blocks shared by every shader, see SceneUniforms
+
+// Shared by everything drawn this frame
+layout(std140, binding = 0) uniform FrameData {
+	float a_Time;
+	float a_DeltaTime;
+};
+
+// The camera for the viewport we are drawing
+layout(std140, binding = 1) uniform ViewData {
+	mat4 a_View;
+	mat4 a_Projection;
+	mat4 a_ViewProjection;
+	vec3 a_CameraPos;
+};
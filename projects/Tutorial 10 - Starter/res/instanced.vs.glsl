@@ -0,0 +1,41 @@
+#version 450
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec4 inColor;
+layout (location = 2) in vec3 inNormal;
+layout (location = 3) in vec2 inUV;
+
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec3 outNormal;
+layout (location = 2) out vec3 outWorldPos;
+layout (location = 3) out vec2 outUV;
+layout (location = 4) out vec3 outTexWeights;
+
+// Each instance's transform and color come from the InstancedMeshRenderer's InstanceBuffer
+struct Instance {
+	mat4 Transform;
+	vec4 Color;
+};
+layout(std430, binding = 1) readonly buffer InstanceData {
+	Instance a_Instances[];
+};
+
+#include "include/scene-uniforms.glsl"
+
+// The transform of the entity that all of the instances belong to
+uniform mat4 a_Model;
+
+void main() {
+	Instance instance = a_Instances[gl_InstanceID];
+	mat4 model = a_Model * instance.Transform;
+
+	outColor = inColor * instance.Color;
+	// Instances can be scaled unevenly, so we need the full inverse-transpose for our normals
+	outNormal = transpose(inverse(mat3(model))) * inNormal;
+	outWorldPos = (model * vec4(inPosition, 1)).xyz;
+	gl_Position = a_ViewProjection * vec4(outWorldPos, 1);
+
+	// Instances only use the first of the material's textures
+	outTexWeights = vec3(1, 0, 0);
+	outUV = inUV;
+}
@@ -1,4 +1,5 @@
-#version 410
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec4 inColor;
@@ -13,17 +14,16 @@ layout (location = 2) out vec3 outWorldPos;
 layout (location = 3) out vec2 outUV;
 layout (location = 4) out vec3 outTexWeights;
 
-uniform mat4 a_ModelViewProjection;
-uniform mat4 a_Model;
-uniform mat4 a_ModelView;
-uniform mat3 a_NormalMatrix;
+#include "include/draw-data.glsl"
+#include "include/scene-uniforms.glsl"
 
 void main() {
+	DrawObject draw = a_Draws[gl_DrawIDARB];
 	outColor = inColor;
-	outNormal = a_NormalMatrix * inNormal;
+	outNormal = mat3(draw.NormalMatrix) * inNormal;
 	outColor = inColor;
-	outWorldPos =  (a_Model * vec4(inPosition, 1)).xyz;
-	gl_Position = a_ModelViewProjection * vec4(inPosition, 1);
+	outWorldPos =  (draw.Model * vec4(inPosition, 1)).xyz;
+	gl_Position = a_ViewProjection * vec4(outWorldPos, 1);
 
 	outTexWeights = vec3(
  sin(inPosition.x / 2.0f) / 2 + 0.5,
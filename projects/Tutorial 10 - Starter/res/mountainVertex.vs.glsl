@@ -1,4 +1,5 @@
-#version 410
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec4 inColor;
@@ -15,8 +16,8 @@ layout (location = 4) out vec3 outTexWeights;
 
 //for the height
 
-uniform mat4 a_ModelViewProjection;
-uniform mat4 a_ModelView;
+#include "include/draw-data.glsl"
+#include "include/scene-uniforms.glsl"
 
 uniform sampler2D s_HeightMap;
 
@@ -29,7 +30,7 @@ void main() {
 	v.z = texture(s_HeightMap, inUV).r * 4;
 
 	// Write the output
-	gl_Position = a_ModelViewProjection * vec4(v, 1.0);
+	gl_Position = a_ViewProjection * a_Draws[gl_DrawIDARB].Model * vec4(v, 1.0);
 
 	float height = v.z- 0.54f;
 
@@ -1,4 +1,4 @@
-#version 410
+#version 450
 
 layout (location = 0) in vec4 inColor;
 layout (location = 1) in vec3 inNormal;
@@ -6,7 +6,7 @@ layout (location = 2) in vec3 inWorldPos;
 
 layout (location = 0) out vec4 outColor;
 
-uniform vec3  a_CameraPos;
+#include "include/scene-uniforms.glsl"
 
 uniform vec3  a_AmbientColor;
 uniform float a_AmbientPower;
@@ -1,10 +1,10 @@
-#version 410
+#version 450
 
 layout(location = 0) in vec4 inColor;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inWorldPos;
 layout(location = 0) out vec4 outColor;
-uniform vec3 a_CameraPos;
+#include "include/scene-uniforms.glsl"
 uniform vec3 a_WaterColor; // The color of the water
 uniform float a_WaterAlpha; // The alpha value for all water rendering (quick hack for transparent water)
 uniform float a_WaterClarity; // Mixing value for water albedo and reflection / refraction effects
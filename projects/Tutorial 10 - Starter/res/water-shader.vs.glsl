@@ -1,6 +1,10 @@
-#version 410
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
 #define M_PI 3.1415926535897932384626433832795
+// Variants can change how many waves we have room for
+#ifndef MAX_WAVES
 #define MAX_WAVES 8
+#endif
 // Heavily inspired by:
 // https://catlikecoding.com/unity/tutorials/flow/waves/
 layout(location = 0) in vec3 inPosition;
@@ -10,10 +14,9 @@ layout(location = 0) out vec4 outColor;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec3 outWorldPos;
 
-uniform mat4 a_ModelViewProjection;
-uniform mat4 a_ModelView;
+#include "include/draw-data.glsl"
+#include "include/scene-uniforms.glsl"
 
-uniform float a_Time;
 uniform float a_Gravity; // This needs to match world units (ex: 9.81 if unit is meters)
 uniform int a_EnabledWaves;
 uniform vec4 a_Waves[MAX_WAVES];
@@ -59,10 +62,15 @@ void main() {
  vec3 tangent = vec3( 1, 0, 0);
  vec3 binorm = vec3( 0, 1, 0);
  vec3 result = pos;
+#ifdef WAVE_COUNT
+ // Variants with a fixed number of waves don't need to check a uniform, and the driver can unroll the loop
+ for (int ix = 0; ix < WAVE_COUNT && ix < MAX_WAVES; ix++) {
+#else
  for (int ix = 0; ix < a_EnabledWaves && ix < MAX_WAVES; ix++) {
+#endif
  result += GerstnerWave(a_Waves[ix], pos, tangent, binorm);
  }
  outNormal = normalize(cross(tangent, binorm));
  outWorldPos = result;
- gl_Position = a_ModelViewProjection * vec4(result, 1);
+ gl_Position = a_ViewProjection * a_Draws[gl_DrawIDARB].Model * vec4(result, 1);
 }
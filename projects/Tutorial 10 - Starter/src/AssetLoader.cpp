@@ -0,0 +1,156 @@
+#include "AssetLoader.h"
+#include "FileStream.h"
+#include "Logging.h"
+
+#include <chrono>
+#include <cstring>
+#include <stb_image.h>
+
+/*
+ * An image that has been decoded by stb_image, but not uploaded yet
+ */
+struct DecodedImage {
+	int                      Width    = 0;
+	int                      Height   = 0;
+	int                      Channels = 0;
+	std::shared_ptr<uint8_t> Pixels;
+};
+
+/*
+ * Decodes an image file into tightly packed 8 bit pixels. We do our own flipping instead of using
+ * stbi_set_flip_vertically_on_load, since that is a global setting and we decode on many threads at once
+ */
+static DecodedImage DecodeImage(const std::string& fileName, int channels, bool flipVertically) {
+	DecodedImage result;
+	int fileChannels = 0;
+	uint8_t* pixels = FileStream::LoadImageFile(fileName.c_str(), &result.Width, &result.Height, &fileChannels, channels);
+	if (pixels == nullptr || result.Width == 0 || result.Height == 0) {
+		if (pixels != nullptr)
+			stbi_image_free(pixels);
+		LOG_WARN("Failed to load image from \"{}\"", fileName);
+		return DecodedImage();
+	}
+	result.Channels = channels;
+	result.Pixels   = std::shared_ptr<uint8_t>(pixels, stbi_image_free);
+
+	if (flipVertically) {
+		size_t rowSize = static_cast<size_t>(result.Width) * channels;
+		std::vector<uint8_t> temp(rowSize);
+		for (int top = 0, bottom = result.Height - 1; top < bottom; top++, bottom--) {
+			uint8_t* topRow    = pixels + top * rowSize;
+			uint8_t* bottomRow = pixels + bottom * rowSize;
+			memcpy(temp.data(), topRow, rowSize);
+			memcpy(topRow, bottomRow, rowSize);
+			memcpy(bottomRow, temp.data(), rowSize);
+		}
+	}
+	return result;
+}
+
+AssetLoader::AssetLoader(ThreadPool& pool) :
+	myPool(pool),
+	myQueue(std::make_shared<UploadQueue>())
+{ }
+
+std::shared_future<Texture2D::Sptr> AssetLoader::LoadTexture(const std::string& fileName, const TextureLoadOptions& options,
+	std::function<void(const Texture2D::Sptr&)> onLoaded)
+{
+	return Load<Texture2D::Sptr, DecodedImage>(
+		[=]() { return DecodeImage(fileName, options.LoadAlpha ? 4 : 3, options.FlipVertically); },
+		[=](DecodedImage& image) -> Texture2D::Sptr {
+			if (image.Pixels == nullptr)
+				return nullptr;
+			Texture2DDescription desc = Texture2DDescription();
+			desc.Width  = image.Width;
+			desc.Height = image.Height;
+			desc.Format = options.LoadAlpha ? InternalFormat::RGBA8 : InternalFormat::RGB8;
+			Texture2D::Sptr result = std::make_shared<Texture2D>(desc);
+			result->LoadData(image.Pixels.get(), image.Width, image.Height, options.LoadAlpha ? PixelFormat::Rgba : PixelFormat::Rgb, PixelType::UByte);
+			return result;
+		},
+		[=](const Texture2D::Sptr& texture) {
+			if (texture != nullptr && onLoaded)
+				onLoaded(texture);
+		});
+}
+
+std::shared_future<TextureCube::Sptr> AssetLoader::LoadTextureCube(const std::string faceFiles[6], bool flipVertically,
+	std::function<void(const TextureCube::Sptr&)> onLoaded)
+{
+	std::vector<std::string> files(faceFiles, faceFiles + 6);
+	ThreadPool* pool = &myPool;
+	return Load<TextureCube::Sptr, std::vector<DecodedImage>>(
+		[=]() {
+			// Our faces are independent, so we can decode all of them at once
+			std::vector<DecodedImage> faces(6);
+			pool->ParallelFor(6, [&](size_t ix) { faces[ix] = DecodeImage(files[ix], 3, flipVertically); });
+			return faces;
+		},
+		[=](std::vector<DecodedImage>& faces) -> TextureCube::Sptr {
+			// Make sure all of our faces are valid, square and the same size before we create anything
+			for (int ix = 0; ix < 6; ix++) {
+				if (faces[ix].Pixels == nullptr || faces[ix].Width != faces[ix].Height || faces[ix].Width != faces[0].Width) {
+					LOG_WARN("Cube map face \"{}\" is missing, or does not match the other faces", files[ix]);
+					return nullptr;
+				}
+			}
+			TextureCubeDesc desc = TextureCubeDesc();
+			desc.Format = InternalFormat::RGB8;
+			desc.Size   = faces[0].Width;
+			TextureCube::Sptr result = std::make_shared<TextureCube>(desc);
+			for (int ix = 0; ix < 6; ix++) {
+				result->LoadData(faces[ix].Width, faces[ix].Height, (CubeMapFace)ix, PixelFormat::Rgb, PixelType::UByte, faces[ix].Pixels.get());
+			}
+			return result;
+		},
+		[=](const TextureCube::Sptr& texture) {
+			if (texture != nullptr && onLoaded)
+				onLoaded(texture);
+		});
+}
+
+std::shared_future<Mesh::Sptr> AssetLoader::LoadMesh(const std::string& fileName, const glm::vec4& baseColor, const ObjLoadOptions& options,
+	std::function<void(const Mesh::Sptr&)> onLoaded)
+{
+	return Load<Mesh::Sptr, ObjMeshSource>(
+		[=]() { return ObjLoader::LoadObjSource(fileName.c_str(), baseColor, options); },
+		[](ObjMeshSource& source) { return ObjLoader::CreateMesh(source); },
+		onLoaded);
+}
+
+std::shared_future<LodGroup> AssetLoader::LoadLodGroup(const std::string& fileName, const glm::vec4& baseColor, const ObjLoadOptions& options,
+	std::function<void(const LodGroup&)> onLoaded)
+{
+	ObjLoadOptions lodOptions = options;
+	lodOptions.BuildLods = true;
+	return Load<LodGroup, ObjMeshSource>(
+		[=]() { return ObjLoader::LoadObjSource(fileName.c_str(), baseColor, lodOptions); },
+		[](ObjMeshSource& source) { return ObjLoader::CreateLodGroup(source); },
+		onLoaded);
+}
+
+size_t AssetLoader::ProcessUploads(double budgetMs) {
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t count = 0;
+
+	while (true) {
+		std::function<void()> upload;
+		{
+			std::lock_guard<std::mutex> lock(myQueue->Mutex);
+			if (myQueue->Uploads.empty())
+				break;
+			upload = std::move(myQueue->Uploads.front());
+			myQueue->Uploads.pop();
+		}
+
+		upload();
+		myQueue->Pending--;
+		count++;
+
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (elapsedMs >= budgetMs)
+			break;
+	}
+
+	return count;
+}
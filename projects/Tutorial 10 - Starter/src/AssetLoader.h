@@ -0,0 +1,167 @@
+/*
+	Loads assets in the background. File IO and decoding happen on a thread pool, and the resulting OpenGL
+	uploads get queued up for the main thread, which works through them a little bit each frame with
+	ProcessUploads. Every load returns a future, and can take a callback that gets invoked on the main
+	thread once the asset is ready, so that assets can pop in as they finish instead of blocking startup
+*/
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+
+#include "ThreadPool.h"
+#include "Texture2D.h"
+#include "TextureCube.h"
+#include "ObjLoader.h"
+#include "Utils.h"
+
+/*
+ * Settings for how an image file should be decoded into a texture
+ */
+struct TextureLoadOptions {
+	/*
+	 * True if the texture should have an alpha channel (RGBA8), false for RGB8
+	 */
+	bool LoadAlpha      = true;
+	/*
+	 * True if the rows of the image should be flipped, so that the first row in the file is at the bottom
+	 */
+	bool FlipVertically = false;
+};
+
+class AssetLoader {
+public:
+	typedef std::shared_ptr<AssetLoader> Sptr;
+	NoCopy(AssetLoader);
+	NoMove(AssetLoader);
+
+	/*
+	 * Creates a new asset loader
+	 * @param pool The thread pool to decode assets on
+	 */
+	AssetLoader(ThreadPool& pool = ThreadPool::Global());
+	~AssetLoader() = default;
+
+	/*
+	 * Loads an asset in two steps, decode is invoked on a worker thread, then upload is invoked on the main
+	 * thread during ProcessUploads to create the asset from the decoded data
+	 * @param decode   Does the CPU work for the asset (reading files, parsing, decompressing)
+	 * @param upload   Creates the asset from the decoded data, this is where any OpenGL calls should happen
+	 * @param onLoaded Optional, invoked on the main thread with the asset once it has been created
+	 * @returns A future that will hold the asset once it has been created, or the exception if either step threw
+	 */
+	template <typename TResult, typename TDecoded>
+	std::shared_future<TResult> Load(
+		std::function<TDecoded()> decode,
+		std::function<TResult(TDecoded&)> upload,
+		std::function<void(const TResult&)> onLoaded = nullptr)
+	{
+		auto promise = std::make_shared<std::promise<TResult>>();
+		std::shared_future<TResult> result = promise->get_future().share();
+		// The queue is shared with our jobs, so that jobs that are still running when we're destroyed are harmless
+		std::shared_ptr<UploadQueue> queue = myQueue;
+		queue->Pending++;
+
+		myPool.Enqueue([=]() {
+			std::shared_ptr<TDecoded> decoded;
+			try {
+				decoded = std::make_shared<TDecoded>(decode());
+			} catch (...) {
+				std::exception_ptr error = std::current_exception();
+				queue->Push([=]() { promise->set_exception(error); });
+				return;
+			}
+			queue->Push([=]() {
+				// Uploads can throw too (ex: a mesh that the GPU won't take), that has to go to whoever is waiting on
+				// the asset instead of out of ProcessUploads
+				try {
+					TResult asset = upload(*decoded);
+					if (onLoaded)
+						onLoaded(asset);
+					promise->set_value(asset);
+				} catch (...) {
+					promise->set_exception(std::current_exception());
+				}
+			});
+		});
+
+		return result;
+	}
+
+	/*
+	 * Loads a texture from an image file
+	 * @param fileName The path of the image to load
+	 * @param options  How the image should be decoded
+	 * @param onLoaded Optional, invoked on the main thread with the texture if it loaded successfully
+	 * @returns A future that will hold the texture (or nullptr if the image could not be loaded)
+	 */
+	std::shared_future<Texture2D::Sptr> LoadTexture(const std::string& fileName, const TextureLoadOptions& options = TextureLoadOptions(),
+		std::function<void(const Texture2D::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Loads a cube map from 6 image files, in the order of CubeMapFace
+	 * @param faceFiles      The paths of the images for each face
+	 * @param flipVertically True if the rows of each face should be flipped
+	 * @param onLoaded       Optional, invoked on the main thread with the cube map if it loaded successfully
+	 * @returns A future that will hold the cube map (or nullptr if the images could not be loaded)
+	 */
+	std::shared_future<TextureCube::Sptr> LoadTextureCube(const std::string faceFiles[6], bool flipVertically = true,
+		std::function<void(const TextureCube::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Loads a mesh from an OBJ file (using its .smesh cache if enabled in the options)
+	 * @param fileName  The path of the OBJ file to load
+	 * @param baseColor The value to set for the vertex color attribute
+	 * @param options   The settings to use for loading the file
+	 * @param onLoaded  Optional, invoked on the main thread with the mesh once it has been created
+	 * @returns A future that will hold the mesh
+	 */
+	std::shared_future<Mesh::Sptr> LoadMesh(const std::string& fileName, const glm::vec4& baseColor = glm::vec4(1.0f),
+		const ObjLoadOptions& options = ObjLoadOptions(), std::function<void(const Mesh::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Loads a mesh from an OBJ file along with its LOD chain, building the chain if the file's .smesh cache
+	 * doesn't already hold one with the same settings
+	 * @param fileName  The path of the OBJ file to load
+	 * @param baseColor The value to set for the vertex color attribute
+	 * @param options   The settings to use for loading the file, BuildLods is always turned on
+	 * @param onLoaded  Optional, invoked on the main thread with the LOD group once its meshes have been created
+	 * @returns A future that will hold the LOD group
+	 */
+	std::shared_future<LodGroup> LoadLodGroup(const std::string& fileName, const glm::vec4& baseColor = glm::vec4(1.0f),
+		const ObjLoadOptions& options = ObjLoadOptions(), std::function<void(const LodGroup&)> onLoaded = nullptr);
+
+	/*
+	 * Creates assets that have finished decoding, this must be called on the OpenGL thread (once per frame).
+	 * At least one upload will be processed per call, so that we always make progress
+	 * @param budgetMs The time in milliseconds that we can spend uploading before we stop for this frame
+	 * @returns The number of assets that were created
+	 */
+	size_t ProcessUploads(double budgetMs);
+
+	/*
+	 * Gets the number of assets that have been requested, but not yet created
+	 */
+	size_t GetPendingCount() const { return myQueue->Pending; }
+
+private:
+	// The uploads that are waiting for the main thread, shared between the loader and its jobs
+	struct UploadQueue {
+		std::mutex                        Mutex;
+		std::queue<std::function<void()>> Uploads;
+		std::atomic<size_t>               Pending{ 0 };
+
+		void Push(std::function<void()>&& upload) {
+			std::lock_guard<std::mutex> lock(Mutex);
+			Uploads.push(std::move(upload));
+		}
+	};
+
+	ThreadPool&                  myPool;
+	std::shared_ptr<UploadQueue> myQueue;
+};
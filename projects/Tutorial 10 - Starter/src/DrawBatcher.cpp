@@ -0,0 +1,72 @@
+#include "DrawBatcher.h"
+
+#include <algorithm>
+
+DrawBatcher::DrawBatcher() :
+	myCapacities{ 0, 0 },
+	myArena(nullptr),
+	myPage(0),
+	myIndexType(GL_NONE)
+{
+	glCreateBuffers(2, myBuffers);
+}
+
+DrawBatcher::~DrawBatcher() {
+	glDeleteBuffers(2, myBuffers);
+}
+
+void DrawBatcher::__Reserve(GLuint buffer, size_t& capacity, size_t bytes) {
+	if (bytes <= capacity)
+		return;
+	// Grow by at least half again, so that a slowly growing scene doesn't reallocate every frame
+	capacity = std::max(bytes, capacity + capacity / 2);
+	glNamedBufferData(buffer, capacity, nullptr, GL_DYNAMIC_DRAW);
+}
+
+void DrawBatcher::Submit(const Mesh::Sptr& mesh, const DrawObject& object, const std::vector<MeshletRange>* ranges) {
+	const GeometryArena::Allocation& allocation = mesh->GetAllocation();
+	// Every command in a multi-draw reads from the same VAO with the same index type
+	if (!myCommands.empty() &&
+		(mesh->GetArena().get() != myArena || allocation.Page != myPage || mesh->GetIndexType() != myIndexType))
+		Flush();
+	myArena     = mesh->GetArena().get();
+	myPage      = allocation.Page;
+	myIndexType = mesh->GetIndexType();
+	myStats.Submitted++;
+
+	// Commands use offsets in indices rather than bytes, our arena keeps index ranges aligned so this always divides evenly
+	GLuint indexSize  = myIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	GLuint firstIndex = static_cast<GLuint>(allocation.IndexOffset / indexSize);
+	if (ranges == nullptr) {
+		myCommands.push_back({ static_cast<GLuint>(mesh->GetIndexCount()), 1, firstIndex, allocation.BaseVertex, 0 });
+		myObjects.push_back(object);
+	}
+	else {
+		// Each range is its own command, so each one needs its own copy of the transforms for gl_DrawID to find
+		for (const MeshletRange& range : *ranges) {
+			myCommands.push_back({ range.IndexCount, 1, firstIndex + range.IndexOffset, allocation.BaseVertex, 0 });
+			myObjects.push_back(object);
+		}
+	}
+}
+
+void DrawBatcher::Flush() {
+	if (myCommands.empty())
+		return;
+
+	__Reserve(myBuffers[0], myCapacities[0], myObjects.size() * sizeof(DrawObject));
+	__Reserve(myBuffers[1], myCapacities[1], myCommands.size() * sizeof(DrawElementsIndirectCommand));
+	glNamedBufferSubData(myBuffers[0], 0, myObjects.size() * sizeof(DrawObject), myObjects.data());
+	glNamedBufferSubData(myBuffers[1], 0, myCommands.size() * sizeof(DrawElementsIndirectCommand), myCommands.data());
+
+	myArena->Bind(myPage);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, myBuffers[0]);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, myBuffers[1]);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, myIndexType, nullptr, static_cast<GLsizei>(myCommands.size()), 0);
+	GeometryArena::CountDraw();
+
+	myStats.Commands += myCommands.size();
+	myStats.Batches++;
+	myCommands.clear();
+	myObjects.clear();
+}
@@ -0,0 +1,96 @@
+/*
+	Collects the draws for a run of entities that share a shader and material, and submits them with a single
+	glMultiDrawElementsIndirect call. The transforms for each draw go in a shader storage buffer, which shaders
+	read with gl_DrawIDARB (ARB_shader_draw_parameters, core in 4.6 as gl_DrawID) instead of from uniforms:
+
+		struct DrawObject { mat4 Model; mat4 NormalMatrix; };
+		layout(std430, binding = 0) readonly buffer DrawData { DrawObject a_Draws[]; };
+
+	The view and projection come from the shared ViewData block instead (see SceneUniforms), so the same objects work
+	for any viewport. Shaders that declare the DrawData block are picked up by Shader::SupportsBatching
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <vector>
+#include "Mesh.h"
+#include "Utils.h"
+
+/*
+ * The per-draw data that batched shaders read from the DrawData buffer. The normal matrix is stored as a mat4
+ * since std430 pads each column of a mat3 to a vec4 anyways
+ */
+struct DrawObject {
+	glm::mat4 Model;
+	glm::mat4 NormalMatrix;
+};
+
+/*
+ * The layout that glMultiDrawElementsIndirect reads its commands in
+ */
+struct DrawElementsIndirectCommand {
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint  BaseVertex;
+	GLuint BaseInstance;
+};
+
+/*
+ * The batched drawing done since the last call to DrawBatcher::ResetStats
+ */
+struct DrawBatchStats {
+	// The number of meshes that were submitted
+	size_t Submitted = 0;
+	// The number of indirect commands they turned into (meshes drawn in several ranges need one per range)
+	size_t Commands  = 0;
+	// The number of glMultiDrawElementsIndirect calls we made
+	size_t Batches   = 0;
+};
+
+class DrawBatcher {
+public:
+	GraphicsClass(DrawBatcher);
+
+	DrawBatcher();
+	~DrawBatcher();
+
+	/*
+	 * Adds a mesh to the current batch. If the mesh is in a different arena page, or uses a different index type,
+	 * than the rest of the batch then the batch is flushed first. The mesh must have indices
+	 * @param mesh   The mesh to draw
+	 * @param object The transforms the shader will see for this draw
+	 * @param ranges Optional, the parts of the mesh's index buffer to draw (see MeshletCuller), or null for all of it
+	 */
+	void Submit(const Mesh::Sptr& mesh, const DrawObject& object, const std::vector<MeshletRange>* ranges = nullptr);
+	/*
+	 * Draws everything in the current batch with the shader and material that are bound. This must be called
+	 * before binding a different shader or applying a different material
+	 */
+	void Flush();
+
+	// Gets the statistics since the last call to ResetStats
+	const DrawBatchStats& GetStats() const { return myStats; }
+	void ResetStats() { myStats = DrawBatchStats(); }
+
+	// The binding point of the DrawData shader storage block
+	static constexpr GLuint DrawDataBinding = 0;
+
+private:
+	// Makes sure that a buffer can hold the given number of bytes, growing it if needed
+	static void __Reserve(GLuint buffer, size_t& capacity, size_t bytes);
+
+	// 0 is the DrawData storage buffer, 1 is the indirect command buffer
+	GLuint myBuffers[2];
+	size_t myCapacities[2];
+
+	// The arena page and index type that every draw in the current batch shares
+	GeometryArena* myArena;
+	size_t         myPage;
+	GLenum         myIndexType;
+
+	std::vector<DrawObject>                  myObjects;
+	std::vector<DrawElementsIndirectCommand> myCommands;
+	DrawBatchStats                           myStats;
+};
@@ -0,0 +1,162 @@
+#include "FileStream.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <climits>
+#include <zlib.h>
+#include <stb_image.h>
+
+// Every gzip member starts with these two bytes
+static const uint8_t GzipMagic[2] = { 0x1F, 0x8B };
+
+FileStream::FileStream(const char* filename) :
+	myInflater(nullptr),
+	mySizeHint(0),
+	myIsOpen(false),
+	myIsEnd(true),
+	myHasError(false)
+{
+	myFile.open(filename, std::ios::binary | std::ios::ate);
+	if (!myFile)
+		return;
+	myIsOpen = true;
+	myIsEnd  = false;
+
+	size_t fileSize = static_cast<size_t>(myFile.tellg());
+	mySizeHint = fileSize;
+	myFile.seekg(0, std::ios::beg);
+
+	uint8_t header[2] = { 0, 0 };
+	if (fileSize >= 18 && myFile.read(reinterpret_cast<char*>(header), 2) && header[0] == GzipMagic[0] && header[1] == GzipMagic[1]) {
+		// The last 4 bytes of a gzip file store the uncompressed size (modulo 4 GB) in little endian
+		uint8_t trailer[4];
+		myFile.seekg(fileSize - 4, std::ios::beg);
+		myFile.read(reinterpret_cast<char*>(trailer), 4);
+		mySizeHint = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<size_t>(trailer[3]) << 24);
+
+		z_stream* inflater = new z_stream();
+		// Adding 16 to the window bits tells zlib to expect a gzip header instead of a zlib one
+		if (inflateInit2(inflater, 16 + MAX_WBITS) != Z_OK) {
+			LOG_WARN("Failed to set up decompression for \"{}\"", filename);
+			delete inflater;
+			myHasError = true;
+			myIsEnd    = true;
+			return;
+		}
+		myInflater = inflater;
+		myInput.resize(InputBufferSize);
+		LOG_TRACE("Reading compressed file \"{}\" ({:.1f} KB -> {:.1f} KB)", filename, fileSize / 1024.0, mySizeHint / 1024.0);
+	}
+
+	myFile.clear();
+	myFile.seekg(0, std::ios::beg);
+}
+
+FileStream::~FileStream() {
+	if (myInflater != nullptr) {
+		z_stream* inflater = static_cast<z_stream*>(myInflater);
+		inflateEnd(inflater);
+		delete inflater;
+	}
+}
+
+size_t FileStream::Read(void* buffer, size_t size) {
+	if (myIsEnd || size == 0)
+		return 0;
+
+	if (myInflater != nullptr) {
+		// zlib counts in 32 bits, so really big reads get split up
+		uint8_t* output = static_cast<uint8_t*>(buffer);
+		size_t read = 0;
+		while (read < size && !myIsEnd)
+			read += __ReadCompressed(output + read, std::min(size - read, (size_t)UINT_MAX));
+		return read;
+	}
+
+	myFile.read(static_cast<char*>(buffer), size);
+	size_t read = static_cast<size_t>(myFile.gcount());
+	if (read < size)
+		myIsEnd = true;
+	return read;
+}
+
+size_t FileStream::__ReadCompressed(uint8_t* buffer, size_t size) {
+	z_stream* inflater = static_cast<z_stream*>(myInflater);
+	inflater->next_out  = buffer;
+	inflater->avail_out = static_cast<uInt>(size);
+
+	while (inflater->avail_out > 0) {
+		// Top up our compressed input whenever zlib has used all of it
+		if (inflater->avail_in == 0) {
+			myFile.read(reinterpret_cast<char*>(myInput.data()), myInput.size());
+			inflater->next_in  = myInput.data();
+			inflater->avail_in = static_cast<uInt>(myFile.gcount());
+			if (inflater->avail_in == 0) {
+				LOG_WARN("Compressed file ended unexpectedly");
+				myHasError = true;
+				myIsEnd    = true;
+				break;
+			}
+		}
+
+		int status = inflate(inflater, Z_NO_FLUSH);
+		if (status == Z_STREAM_END) {
+			// A gzip file can be made of several members one after the other, so keep going if there's more
+			if (inflater->avail_in == 0 && myFile.peek() == std::char_traits<char>::eof()) {
+				myIsEnd = true;
+				break;
+			}
+			inflateReset(inflater);
+		}
+		else if (status != Z_OK && status != Z_BUF_ERROR) {
+			LOG_WARN("Failed to decompress file: {}", inflater->msg != nullptr ? inflater->msg : "unknown error");
+			myHasError = true;
+			myIsEnd    = true;
+			break;
+		}
+	}
+
+	return size - inflater->avail_out;
+}
+
+bool FileStream::ReadAll(std::vector<char>& result) {
+	result.clear();
+	if (!myIsOpen)
+		return false;
+
+	// Our size hint is usually exact, so we can read straight into place, growing only if it was wrong
+	size_t size = 0;
+	result.resize(mySizeHint + 1);
+	while (true) {
+		size += Read(result.data() + size, result.size() - size);
+		if (myIsEnd)
+			break;
+		result.resize(result.size() * 2);
+	}
+	result.resize(size);
+	return !myHasError;
+}
+
+uint8_t* FileStream::LoadImageFile(const char* filename, int* width, int* height, int* channels, int desiredChannels) {
+	FileStream stream(filename);
+	if (!stream.IsOpen())
+		return nullptr;
+
+	// stb_image pulls data through these as it decodes, so we never need the whole file in memory
+	stbi_io_callbacks callbacks;
+	callbacks.read = [](void* user, char* data, int size) -> int {
+		return static_cast<int>(static_cast<FileStream*>(user)->Read(data, size));
+	};
+	callbacks.skip = [](void* user, int count) {
+		// We can only move forward through a compressed stream, so skipping is just reading
+		char scratch[4096];
+		FileStream* stream = static_cast<FileStream*>(user);
+		while (count > 0 && !stream->IsEnd())
+			count -= static_cast<int>(stream->Read(scratch, std::min(count, (int)sizeof(scratch))));
+	};
+	callbacks.eof = [](void* user) -> int {
+		return static_cast<FileStream*>(user)->IsEnd() ? 1 : 0;
+	};
+
+	return stbi_load_from_callbacks(&callbacks, &stream, width, height, channels, desiredChannels);
+}
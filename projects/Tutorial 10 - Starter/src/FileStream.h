@@ -0,0 +1,80 @@
+/*
+	Reads a file from start to finish, transparently decompressing it if it is gzip compressed. Compressed
+	files are recognized by their header rather than their extension, and are inflated a piece at a time as
+	they are read, so callers can parse the data as it arrives instead of inflating the whole file first
+*/
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "Utils.h"
+
+class FileStream {
+public:
+	NoCopy(FileStream);
+	NoMove(FileStream);
+
+	/*
+	 * Opens the given file for reading, use IsOpen to check if the file could be opened
+	 * @param filename The path of the file to read, this may be a plain or gzip compressed file
+	 */
+	FileStream(const char* filename);
+	~FileStream();
+
+	// Returns true if the file was opened successfully
+	bool IsOpen() const { return myIsOpen; }
+	// Returns true if the file is gzip compressed
+	bool IsCompressed() const { return myInflater != nullptr; }
+	// Returns true once all of the file has been read, or if reading failed
+	bool IsEnd() const { return myIsEnd; }
+	// Returns true if the file could not be read (ex: the compressed data is corrupt)
+	bool HasError() const { return myHasError; }
+
+	/*
+	 * Gets the number of bytes that the file will give us once decompressed. For compressed files this
+	 * comes from the gzip trailer, which is only accurate for files under 4 GB, so use it as a hint only
+	 */
+	size_t GetSizeHint() const { return mySizeHint; }
+
+	/*
+	 * Reads the next bytes of the file. The buffer is always filled unless we reach the end of the file
+	 * @param buffer The buffer to read into
+	 * @param size   The number of bytes to read
+	 * @returns The number of bytes that were read
+	 */
+	size_t Read(void* buffer, size_t size);
+
+	/*
+	 * Reads the rest of the file into result, replacing its contents
+	 * @returns False if the file could not be read
+	 */
+	bool ReadAll(std::vector<char>& result);
+
+	/*
+	 * Decodes an image file with stb_image, reading it through a FileStream so that compressed images work too
+	 * @param filename        The path of the image to load
+	 * @param width           Will store the width of the image
+	 * @param height          Will store the height of the image
+	 * @param channels        Will store the number of channels in the file
+	 * @param desiredChannels The number of channels to convert the image to, or 0 to keep the file's channels
+	 * @returns The pixels of the image, which must be freed with stbi_image_free, or nullptr if loading failed
+	 */
+	static uint8_t* LoadImageFile(const char* filename, int* width, int* height, int* channels, int desiredChannels);
+
+private:
+	// The size of the buffer that we read compressed data into
+	static const size_t InputBufferSize = 256 * 1024;
+
+	std::ifstream        myFile;
+	// The zlib stream used to inflate compressed files, nullptr for plain files
+	void*                myInflater;
+	std::vector<uint8_t> myInput;
+	size_t               mySizeHint;
+	bool                 myIsOpen;
+	bool                 myIsEnd;
+	bool                 myHasError;
+
+	size_t __ReadCompressed(uint8_t* buffer, size_t size);
+};
@@ -18,10 +18,20 @@
 #include "Texture2D.h"
 #include "TextureSampler.h"
 #include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCache.h"
+#include "LodGroup.h"
+#include "DrawBatcher.h"
+#include "InstancedMeshRenderer.h"
+#include "AssetLoader.h"
+#include "ShaderCache.h"
+#include "FileStream.h"
 
 #include "Transform.h"
 
 #include <functional>
+#include <stb_image.h>
 
 struct UpdateBehaviour {
 	std::function<void(entt::entity e, float dt)> Function;
@@ -90,7 +100,9 @@ void Game::Run()
 	Initialize();
 	InitImGui();
 
+	double loadStart = glfwGetTime();
 	LoadContent();
+	bool assetsLoaded = false;
 
 	static float prevFrame = glfwGetTime();
 
@@ -102,6 +114,29 @@ void Game::Run()
 		float thisFrame = glfwGetTime();
 		float deltaTime = thisFrame - prevFrame;
 
+		// Create any assets that have finished loading, without spending too much of our frame on it
+		myAssetLoader->ProcessUploads(AssetUploadBudgetMs);
+		// Pick up the shaders that the driver has finished compiling, until then they get drawn with our fallback
+		Shader::ProcessPending(ShaderFinishBudgetMs);
+		if (!assetsLoaded && myAssetLoader->GetPendingCount() == 0 && Shader::GetPendingCount() == 0) {
+			assetsLoaded = true;
+			const MeshIndexStats& indexStats = Mesh::GetIndexStats();
+			LOG_INFO("Finished loading assets in {:.2f} s", glfwGetTime() - loadStart);
+			LOG_INFO("Loaded {} indexed meshes ({} with 16 bit indices), {:.1f} KB of indices, saved {:.1f} KB",
+				indexStats.IndexedMeshes, indexStats.ShortIndexMeshes, indexStats.IndexBytes / 1024.0, indexStats.BytesSaved / 1024.0);
+			const ResourceCacheStats& cacheStats = myResources->GetStats();
+			LOG_INFO("Resource cache: {} hits, {} misses, saved {:.1f} KB of GPU memory",
+				cacheStats.Hits, cacheStats.Misses, cacheStats.BytesSaved / 1024.0);
+			const ShaderCacheStats& shaderStats = ShaderCache::GetStats();
+			LOG_INFO("Shaders: {} from the cache in {:.2f} ms, {} compiled in {:.2f} ms ({} cached binaries rejected)",
+				shaderStats.Hits, shaderStats.WarmMs, shaderStats.Misses, shaderStats.ColdMs, shaderStats.Rejected);
+			for (const GeometryArena* arena : GeometryArena::GetArenas()) {
+				GeometryArenaStats arenaStats = arena->GetStats();
+				LOG_INFO("Geometry arena '{}': {} meshes in {} pages, using {:.1f} KB of {:.1f} KB reserved", arena->DebugName,
+					arenaStats.Allocations, arenaStats.Pages, arenaStats.GetUsedBytes() / 1024.0, arenaStats.GetReservedBytes() / 1024.0);
+			}
+		}
+
 		Update(deltaTime);
 		Draw(deltaTime);
 
@@ -156,6 +191,9 @@ void Game::Initialize() {
 	LOG_INFO(glGetString(GL_RENDERER));
 	LOG_INFO(glGetString(GL_VERSION));
 
+	// Let the driver compile our shaders on its own threads, if it can
+	Shader::InitParallelCompile((GLADloadproc)glfwGetProcAddress);
+
 	// Enable debugging, and route messages to our callback
 	glEnable(GL_DEBUG_OUTPUT);
 	glDebugMessageCallback(GlDebugMessage, this);
@@ -172,7 +210,10 @@ void Game::Shutdown() {
 	glfwTerminate();
 }
 
-Mesh::Sptr MakeSubdividedPlane(float size, int numSections, bool worldUvs = true) {
+/*
+ * Builds the data for a grid of numSections x numSections quads, this doesn't touch OpenGL so it can be done on any thread
+ */
+MeshData MakeSubdividedPlaneData(float size, int numSections, bool worldUvs = true) {
 	LOG_ASSERT(numSections > 0, "Number of sections must be greater than 0!");
 	LOG_ASSERT(size != 0, "Size cannot be zero!");
 	// Determine the number of edge vertices, and the number of vertices and indices we'll need
@@ -180,8 +221,11 @@ Mesh::Sptr MakeSubdividedPlane(float size, int numSections, bool worldUvs = true
 	size_t vertexCount = numEdgeVerts * numEdgeVerts;
 	size_t indexCount = numSections * numSections * 6;
 	// Allocate some memory for our vertices and indices
-	Vertex* vertices = new Vertex[vertexCount];
-	uint32_t* indices = new uint32_t[indexCount];
+	MeshData data;
+	data.Vertices.resize(vertexCount);
+	data.Indices.resize(indexCount);
+	Vertex* vertices = data.Vertices.data();
+	uint32_t* indices = data.Indices.data();
 	// Determine where to start vertices from, and the step pre grid square
 	float start = 0;
 	float step = size / numSections;
@@ -196,6 +240,8 @@ Mesh::Sptr MakeSubdividedPlane(float size, int numSections, bool worldUvs = true
 			vert.Position.z = 0.6f;
 			// Set its normal
 			vert.Normal = glm::vec3(0, 0, 1);
+			// U runs along X either way, so every vertex shares the same tangent
+			vert.Tangent = glm::vec4(1, 0, 0, 1);
 			// The UV will go from [0, 1] across the entire plane (can change this later)
 			if (worldUvs) {
 				vert.UV.x = vert.Position.x;
@@ -228,18 +274,139 @@ Mesh::Sptr MakeSubdividedPlane(float size, int numSections, bool worldUvs = true
 			indices[index++] = p4;
 		}
 	}
-	// Create the result, then clean up the arrays we used
-	Mesh::Sptr result = std::make_shared<Mesh>(vertices, vertexCount, indices, indexCount);
-	delete[] vertices;
-	delete[] indices;
-	// Return the result
+	// A row by row grid makes poor use of the vertex cache, so we reorder it before uploading
+	MeshOptimizeReport report = MeshOptimizer::Optimize(data);
+	LOG_TRACE("Optimized {0}x{0} plane, ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}", numSections,
+		report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR);
+	return data;
+}
+
+/*
+ * Creates a mesh from the given data, optionally with our compact vertex format
+ */
+Mesh::Sptr MakeMesh(const MeshData& data, bool packed = false) {
+	if (packed) {
+		std::vector<PackedVertex> packedVertices = PackedVertex::Pack(data.Vertices);
+		return std::make_shared<Mesh>(packedVertices.data(), packedVertices.size(), data.Indices.data(), data.Indices.size());
+	}
+	return std::make_shared<Mesh>(data.Vertices.data(), data.Vertices.size(), data.Indices.data(), data.Indices.size());
+}
+
+/*
+ * The decoded levels of a LOD chain, along with the bounds that we need to pick between them
+ */
+struct LodChainData {
+	std::vector<MeshLodLevel> Levels;
+	// The meshlets for each level, or empty if the levels aren't split up
+	std::vector<std::vector<Meshlet>> Meshlets;
+	glm::vec3                 Center = glm::vec3(0.0f);
+	float                     Radius = 0.0f;
+};
+
+/*
+ * Builds the LOD chain for a heightmapped plane. The plane is flat until its shader pushes it up with the heightmap,
+ * so we look up the same heights here and measure each level's error against those, otherwise the simplifier would
+ * happily flatten every hill. The same heights give us the bounds and cones for each level's meshlets. The levels are
+ * cached next to the heightmap (see MeshCache), so they are only rebuilt if the heightmap, the plane or the LOD
+ * settings change. This doesn't touch OpenGL so it can be done on any thread
+ */
+LodChainData MakeHeightmapLods(const MeshData& data, const char* heightMapFile, float heightScale) {
+	LodChainData result;
+	int width = 0, height = 0, channels = 0;
+	uint8_t* pixels = FileStream::LoadImageFile(heightMapFile, &width, &height, &channels, 1);
+	if (pixels == nullptr) {
+		LOG_WARN("Failed to load heightmap \"{}\", terrain will not have LODs", heightMapFile);
+		result.Levels.push_back({ data, 0.0f });
+		return result;
+	}
+
+	// Sample the heightmap the same way the GPU does (bilinear, flipped vertically like our textures are)
+	auto texel = [&](int x, int y) {
+		x = glm::clamp(x, 0, width - 1);
+		y = glm::clamp(y, 0, height - 1);
+		return pixels[(height - 1 - y) * width + x] / 255.0f;
+	};
+	auto displace = [&](const MeshData& mesh) {
+		std::vector<glm::vec3> displaced(mesh.Vertices.size());
+		for (size_t ix = 0; ix < mesh.Vertices.size(); ix++) {
+			const Vertex& vertex = mesh.Vertices[ix];
+			float x = vertex.UV.x * width - 0.5f, y = vertex.UV.y * height - 0.5f;
+			int   x0 = (int)floorf(x), y0 = (int)floorf(y);
+			float fx = x - x0, fy = y - y0;
+			float sample = glm::mix(
+				glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx),
+				glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx), fy);
+			displaced[ix] = glm::vec3(vertex.Position.x, vertex.Position.y, sample * heightScale);
+		}
+		return displaced;
+	};
+	std::vector<glm::vec3> displaced = displace(data);
+
+	glm::vec3 min = displaced[0], max = displaced[0];
+	for (const glm::vec3& position : displaced) {
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	result.Center = (min + max) * 0.5f;
+	result.Radius = glm::length(max - min) * 0.5f;
+
+	// The heightmap is the cache's source file, everything else that the levels depend on goes into the LOD key
+	LodChainOptions options;
+	uint64_t lodKey = MeshCache::HashBytes(data.Vertices.data(), data.Vertices.size() * sizeof(Vertex));
+	lodKey = MeshCache::HashBytes(data.Indices.data(), data.Indices.size() * sizeof(uint32_t), lodKey);
+	lodKey = MeshCache::HashBytes(&heightScale, sizeof(float), lodKey);
+	lodKey = MeshCache::HashLodOptions(options, lodKey);
+	MappedMeshData cached;
+	if (MeshCache::TryLoad(heightMapFile, glm::vec4(1.0f), 0, lodKey, cached)) {
+		result.Levels.push_back({ data, 0.0f });
+		for (const MappedLodLevel& level : cached.Lods) {
+			MeshLodLevel lod;
+			lod.Data.Vertices.assign(level.Vertices, level.Vertices + level.VertexCount);
+			lod.Data.Indices.assign(level.Indices, level.Indices + level.IndexCount);
+			lod.Error = level.Error;
+			result.Levels.push_back(std::move(lod));
+		}
+		LOG_TRACE("Loaded terrain LODs from cache '{}'", MeshCache::GetCachePath(heightMapFile));
+	}
+	else {
+		result.Levels = MeshSimplifier::BuildLodChain(data, options, &displaced);
+		uint64_t sourceHash = 0;
+		if (MeshCache::HashFile(heightMapFile, sourceHash)) {
+			// The plane is quick to make, so we leave it out and only store the levels after it
+			std::vector<MeshLodLevel> lods(result.Levels.begin() + 1, result.Levels.end());
+			MeshCache::Write(heightMapFile, sourceHash, glm::vec4(1.0f), 0, lodKey, MeshData(), lods);
+		}
+	}
+	for (MeshLodLevel& level : result.Levels) {
+		// Simplifying drops vertices, so every level needs its own heights
+		std::vector<glm::vec3> levelDisplaced = displace(level.Data);
+		result.Meshlets.push_back(MeshOptimizer::BuildMeshlets(level.Data, MeshletOptions(), &levelDisplaced));
+		LOG_TRACE("Terrain LOD: {} triangles, error {:.4f}, {} meshlets", level.Data.Indices.size() / 3, level.Error, result.Meshlets.back().size());
+	}
+	stbi_image_free(pixels);
+	return result;
+}
+
+/*
+ * Creates the meshes for a LOD chain, this must be called on the OpenGL thread
+ */
+LodGroup MakeLodGroup(const LodChainData& data, bool packed = false) {
+	LodGroup result;
+	result.Center = data.Center;
+	result.Radius = data.Radius;
+	for (size_t ix = 0; ix < data.Levels.size(); ix++) {
+		Mesh::Sptr mesh = MakeMesh(data.Levels[ix].Data, packed);
+		if (ix < data.Meshlets.size())
+			mesh->SetMeshlets(data.Meshlets[ix]);
+		result.Levels.push_back({ mesh, data.Levels[ix].Error });
+	}
 	return result;
 }
 
 
 Mesh::Sptr MakeInvertedCube() {
-	// Create our 4 vertices
-	Vertex verts[8] = {
+	// Create our 8 vertices, the skybox shader only needs positions
+	PositionVertex verts[8] = {
 		// Position
 		// x y z
 		{{ -1.0f, -1.0f, -1.0f }}, {{ 1.0f, -1.0f, -1.0f }}, {{ -1.0f, 1.0f, -1.0f }}, {{ 1.0f, 1.0f, -1.0f }},
@@ -255,6 +422,39 @@ Mesh::Sptr MakeInvertedCube() {
 	return std::make_shared<Mesh>(verts, 8, indices, 36);
 }
 
+/*
+ * Creates a box centered on the origin, with normals, tangents and UVs for lighting
+ * @param halfSize The distance from the center to each face
+ */
+MeshData MakeCubeData(const glm::vec3& halfSize) {
+	static const glm::vec3 normals[6] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+	};
+	MeshData data;
+	// Each face gets its own 4 vertices, since the corners need a different normal for each face they touch
+	for (const glm::vec3& normal : normals) {
+		glm::vec3 up = glm::abs(normal.z) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+		// u x v = normal, so the quads below wind counter-clockwise when seen from outside
+		glm::vec3 u = glm::cross(up, normal);
+		glm::vec3 v = glm::cross(normal, u);
+		uint32_t first = static_cast<uint32_t>(data.Vertices.size());
+		for (int iy = 0; iy < 2; iy++) {
+			for (int ix = 0; ix < 2; ix++) {
+				Vertex vert;
+				vert.Position = (normal + u * (ix * 2.0f - 1.0f) + v * (iy * 2.0f - 1.0f)) * halfSize;
+				vert.Color = glm::vec4(1.0f);
+				vert.Normal = normal;
+				vert.UV = glm::vec2(ix, iy);
+				vert.Tangent = glm::vec4(u, 1.0f);
+				data.Vertices.push_back(vert);
+			}
+		}
+		uint32_t quad[6] = { first, first + 1, first + 2, first + 2, first + 1, first + 3 };
+		data.Indices.insert(data.Indices.end(), quad, quad + 6);
+	}
+	return data;
+}
+
 glm::vec4 testColor = glm::vec4(1.0f, 0.0f, 1.0f, 1.0f);
 
 
@@ -323,10 +523,26 @@ void Game::LoadContent() {
 
 	//Mesh::Sptr monkey = ObjLoader::LoadObjToMesh("monkey.obj");
 
-	Shader::Sptr phong = std::make_shared<Shader>();
-	phong->Load("lighting.vs.glsl", "textured-blinn-phong.fs.glsl");
-
-	Texture2D::Sptr albedo = Texture2D::LoadFromFile("color-grid.png");
+	// Everything from here on gets decoded in the background, and uploaded a bit at a time by Run
+	myAssetLoader = std::make_shared<AssetLoader>();
+	// Entities that share a shader and material get drawn together
+	myDrawBatcher = std::make_shared<DrawBatcher>();
+	// The time and camera get uploaded once for every shader, instead of being set on each one we bind
+	mySceneUniforms = std::make_shared<SceneUniforms>();
+	// All of our resources go through the cache, so that textures shared between materials only get loaded once
+	myResources = std::make_shared<ResourceCache>(myAssetLoader);
+	// Everything else is drawn with this until its own shader is ready, so this is the only one we wait for
+	myFallbackShader = std::make_shared<Shader>();
+	myFallbackShader->DebugName = "Fallback";
+	myFallbackShader->Load("lighting.vs.glsl", "fallback.fs.glsl");
+
+	Shader::Sptr phong = myResources->LoadShader("lighting.vs.glsl", "textured-blinn-phong.fs.glsl");
+	// The skybox used to turn on stb_image's vertical flip for every image after it, so our terrain textures
+	// were flipped but these weren't. We keep that behaviour by asking for the flip explicitly
+	TextureLoadOptions flipped = TextureLoadOptions();
+	flipped.FlipVertically = true;
+
+	std::shared_future<Texture2D::Sptr> albedo = myResources->LoadTexture("color-grid.png");
 
 	SamplerDesc description = SamplerDesc();
 	description.MinFilter = MinFilter::LinearMipNearest;
@@ -343,35 +559,62 @@ void Game::LoadContent() {
 	testMat->Set("a_LightShininess", 256.0f);
 	testMat->Set("a_LightAttenuation", 1.0f / 100.0f);
 	// Previously testMat->Set("s_Albedo", albedo, Linear);
-	testMat->Set("s_Albedos[0]", Texture2D::LoadFromFile("grass.jpg"), Linear);
-	testMat->Set("s_Albedos[1]", Texture2D::LoadFromFile("moss.jpg"), Linear);
-	testMat->Set("s_Albedos[2]", Texture2D::LoadFromFile("brick.jpg"), Linear);
+	myResources->LoadTexture("grass.jpg", TextureLoadOptions(), [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[0]", tex, Linear); });
+	myResources->LoadTexture("moss.jpg",  TextureLoadOptions(), [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[1]", tex, Linear); });
+	myResources->LoadTexture("brick.jpg", TextureLoadOptions(), [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[2]", tex, Linear); });
 
 
 	SceneManager::RegisterScene("Test");
 	SceneManager::RegisterScene("Test2");
 	SceneManager::SetCurrentScene("Test");
 
+	//Brick Wall, every brick is an instance of the same mesh, so the whole wall is a single draw
+	{
+		// Our bricks only use a single texture, so we ask for the variant that doesn't sample the other two
+		Shader::Sptr instancedShader = myResources->LoadShader("instanced.vs.glsl", "textured-blinn-phong.fs.glsl", { { "ALBEDO_COUNT", "1" } });
+		Material::Sptr brickMat = std::make_shared<Material>(instancedShader);
+		brickMat->Set("a_LightPos", { 2, 0, 4 });
+		brickMat->Set("a_LightColor", { 1.0f, 1.0f, 1.0f });
+		brickMat->Set("a_AmbientColor", { 1.0f, 1.0f, 1.0f });
+		brickMat->Set("a_AmbientPower", 0.1f);
+		brickMat->Set("a_LightSpecPower", 0.5f);
+		brickMat->Set("a_LightShininess", 256.0f);
+		brickMat->Set("a_LightAttenuation", 1.0f / 100.0f);
+		myResources->LoadTexture("moss.jpg", TextureLoadOptions(), [=](const Texture2D::Sptr& tex) { brickMat->Set("s_Albedos[0]", tex, Linear); });
+
+		// 6 rows of 8, with every other row shifted over by half a brick
+		const int columns = 8, rows = 6;
+		const glm::vec3 brickSize = { 0.5f, 0.25f, 0.2f };
+		InstanceBuffer::Sptr bricks = std::make_shared<InstanceBuffer>(columns * rows);
+		for (int row = 0; row < rows; row++) {
+			for (int column = 0; column < columns; column++) {
+				glm::vec3 position = { (column + (row % 2) * 0.5f) * brickSize.x * 2.1f, 0.0f, row * brickSize.z * 2.1f };
+				glm::vec4 color = glm::vec4(glm::mix(glm::vec3(1.0f, 0.6f, 0.5f), glm::vec3(0.7f, 0.7f, 1.0f), row / (rows - 1.0f)), 1.0f);
+				bricks->Add(glm::translate(glm::mat4(1.0f), position), color);
+			}
+		}
+
+		auto& ecs = GetRegistry("Test"); // If you've changed the name of the scene, you'll need to modify this!
+		entt::entity e1 = ecs.create();
+		ecs.get_or_assign<Transform>(e1).SetPosition(glm::vec3(-4.0f, 4.0f, 2.0f));
+		InstancedMeshRenderer& m1 = ecs.assign<InstancedMeshRenderer>(e1);
+		m1.Material = brickMat;
+		m1.Mesh = MakeMesh(MakeCubeData(brickSize));
+		m1.Instances = bricks;
+	}
+
 	auto scene = CurrentScene();
 
-	scene->SkyboxShader = std::make_shared<Shader>();
-	scene->SkyboxShader->Load("cubemap.vs.glsl", "cubemap.fs.glsl");
+	scene->SkyboxShader = myResources->LoadShader("cubemap.vs.glsl", "cubemap.fs.glsl");
 	scene->SkyboxMesh = MakeInvertedCube();
 
-	std::string files[6] = {
-		std::string("cubemap/graycloud_lf.jpg"),
-		std::string("cubemap/graycloud_rt.jpg"),
-		std::string("cubemap/graycloud_dn.jpg"),
-		std::string("cubemap/graycloud_up.jpg"),
-		std::string("cubemap/graycloud_ft.jpg"),
-		std::string("cubemap/graycloud_bk.jpg")
-	};
-	scene->Skybox = TextureCube::LoadFromFiles(files);
+
+	// We hang on to these so that we can give them the skybox once it loads
+	Material::Sptr terrainMat, waterMat;
 
 	//Terrain Plane
 	{
-		Shader::Sptr mountainShader = std::make_shared<Shader>();
-		mountainShader->Load("mountainVertex.vs.glsl", "mountainFragment.fs.glsl");
+		Shader::Sptr mountainShader = myResources->LoadShader("mountainVertex.vs.glsl", "mountainFragment.fs.glsl");
 		//mountainShader->Load("passthrough.vs.glsl", "passthrough.fs.glsl");
 		Material::Sptr testMat = std::make_shared<Material>(mountainShader);
 
@@ -385,25 +628,32 @@ void Game::LoadContent() {
 		// Previously testMat->Set("s_Albedo", albedo, Linear);
 
 		//I used my own textures, instead of sand grass and rock, the heightmap makes for nice snow
-		testMat->Set("s_Albedos[0]", Texture2D::LoadFromFile("moss.jpg"), Linear);
-		testMat->Set("s_Albedos[1]", Texture2D::LoadFromFile("dirt.jpg"), Linear);
-		testMat->Set("s_Albedos[2]", Texture2D::LoadFromFile("heightmap.bmp"), Linear);
+		myResources->LoadTexture("moss.jpg",      flipped, [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[0]", tex, Linear); });
+		myResources->LoadTexture("dirt.jpg",      flipped, [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[1]", tex, Linear); });
+		myResources->LoadTexture("heightmap.bmp", flipped, [=](const Texture2D::Sptr& tex) { testMat->Set("s_Albedos[2]", tex, Linear); });
 
-		testMat->Set("s_HeightMap", Texture2D::LoadFromFile("heightmap.bmp"), Linear);
+		myResources->LoadTexture("heightmap.bmp", flipped, [=](const Texture2D::Sptr& tex) { testMat->Set("s_HeightMap", tex, Linear); });
 
-		testMat->Set("s_Environment", scene->Skybox);
+		terrainMat = testMat;
 		testMat->HasTransparency = false;
 		auto& ecs = GetRegistry("Test"); // If you've changed the name of the scene, you'll need to modify this!
 		entt::entity e1 = ecs.create();
 		MeshRenderer& m1 = ecs.assign<MeshRenderer>(e1);
 		m1.Material = testMat;
-		m1.Mesh = MakeSubdividedPlane(20.0f, 200, false);
+		// The renderer skips entities without a mesh, so the terrain will just pop in once it's ready
+		myAssetLoader->Load<LodGroup, LodChainData>(
+			[]() { return MakeHeightmapLods(MakeSubdividedPlaneData(20.0f, 200, false), "heightmap.bmp", 4.0f); },
+			[](LodChainData& data) { return MakeLodGroup(data, true); },
+			[&ecs, e1](const LodGroup& lods) {
+				ecs.assign<LodGroup>(e1, lods);
+				ecs.get<MeshRenderer>(e1).Mesh = lods.Levels[0].Mesh;
+			});
 	}
 
 	//Water Plane
 	{
-		Shader::Sptr waterShader = std::make_shared<Shader>();
-		waterShader->Load("water-shader.vs.glsl", "water-shader.fs.glsl");
+		// Our water always has the same 3 waves, so we use a variant where that's fixed instead of read from a_EnabledWaves
+		Shader::Sptr waterShader = myResources->LoadShader("water-shader.vs.glsl", "water-shader.fs.glsl", { { "WAVE_COUNT", "3" } });
 		Material::Sptr testMat = std::make_shared<Material>(waterShader);
 		testMat->Set("a_EnabledWaves", 3);
 		testMat->Set("a_Gravity", 9.81f / 35);
@@ -416,15 +666,33 @@ void Game::LoadContent() {
 		testMat->Set("a_WaterClarity", 0.5f);
 		testMat->Set("a_FresnelPower", 0.2f);
 		testMat->Set("a_RefractionIndex", 1.0f / 1.34f);
-		testMat->Set("s_Environment", scene->Skybox);
+		waterMat = testMat;
 		testMat->HasTransparency = true;
 		auto& ecs = GetRegistry("Test"); // If you've changed the name of the scene, you'll need to modify this!
 		entt::entity e1 = ecs.create();
 		MeshRenderer& m1 = ecs.assign<MeshRenderer>(e1);
 		m1.Material = testMat;
-		m1.Mesh = MakeSubdividedPlane(20.0f, 100);
+		myAssetLoader->Load<Mesh::Sptr, MeshData>(
+			[]() { return MakeSubdividedPlaneData(20.0f, 100, true); },
+			[](MeshData& data) { return MakeMesh(data, true); },
+			[&ecs, e1](const Mesh::Sptr& mesh) { ecs.get<MeshRenderer>(e1).Mesh = mesh; });
 	}
 
+	// Our terrain and water both reflect the skybox, so they get it once it has loaded
+	std::string files[6] = {
+		std::string("cubemap/graycloud_lf.jpg"),
+		std::string("cubemap/graycloud_rt.jpg"),
+		std::string("cubemap/graycloud_dn.jpg"),
+		std::string("cubemap/graycloud_up.jpg"),
+		std::string("cubemap/graycloud_ft.jpg"),
+		std::string("cubemap/graycloud_bk.jpg")
+	};
+	myResources->LoadTextureCube(files, true, [=](const TextureCube::Sptr& skybox) {
+		scene->Skybox = skybox;
+		terrainMat->Set("s_Environment", skybox);
+		waterMat->Set("s_Environment", skybox);
+	});
+
 	glfwSetMouseButtonCallback(myWindow, mouseClickCallback);
 	//this should be used only for the perspective window
 	glfwSetCursorPosCallback(myWindow, mouseMoveCallback);
@@ -569,6 +837,13 @@ void Game::Update(float deltaTime) {
 }
 
 void Game::Draw(float deltaTime) {
+	// Every viewport adds to these while culling, so they start over each frame
+	myMeshletStats = MeshletCullStats();
+	GeometryArena::BeginFrame();
+	InstanceBuffer::BeginFrame();
+	Shader::BeginFrame();
+	mySceneUniforms->BeginFrame(static_cast<float>(glfwGetTime()), deltaTime);
+	myDrawBatcher->ResetStats();
 
 	glm::ivec4 viewportFull = {
 	0,0,
@@ -631,6 +906,76 @@ void Game::DrawGui(float deltaTime) {
 	ImGui::Begin("Debug");
 	// Draw a formatted text line
 	ImGui::Text("Time: %f", glfwGetTime());
+	// Show how much memory our index buffers are using
+	const MeshIndexStats& indexStats = Mesh::GetIndexStats();
+	ImGui::Text("Index memory: %.1f KB (saved %.1f KB)", indexStats.IndexBytes / 1024.0, indexStats.BytesSaved / 1024.0);
+	ImGui::Text("16 bit indices: %zu of %zu meshes", indexStats.ShortIndexMeshes, indexStats.IndexedMeshes);
+	// Show how many duplicate loads our resource cache has saved us
+	const ResourceCacheStats& cacheStats = myResources->GetStats();
+	ImGui::Text("Resource cache: %zu hits, %zu misses (saved %.1f KB)", cacheStats.Hits, cacheStats.Misses, cacheStats.BytesSaved / 1024.0);
+	// Show how many meshlets we skipped drawing this frame, across all of our viewports
+	ImGui::Text("Meshlets: %zu of %zu drawn (%zu off screen, %zu back facing)",
+		myMeshletStats.Total - myMeshletStats.Frustum - myMeshletStats.Backface, myMeshletStats.Total, myMeshletStats.Frustum, myMeshletStats.Backface);
+	// Show how many VAO binds we skipped this frame by keeping our meshes in shared buffers
+	const GeometryArenaFrameStats& arenaFrameStats = GeometryArena::GetFrameStats();
+	ImGui::Text("Draws: %zu, VAO binds: %zu (%zu skipped)", arenaFrameStats.Draws, arenaFrameStats.Binds, arenaFrameStats.BindsSaved);
+	// Show how many of those draws were batches, and how many meshes went into them
+	const DrawBatchStats& batchStats = myDrawBatcher->GetStats();
+	ImGui::Text("Batched: %zu meshes as %zu commands in %zu multi-draws", batchStats.Submitted, batchStats.Commands, batchStats.Batches);
+	// Show how much instance data we had to send this frame, this should be nothing unless an instance changed
+	const InstanceUploadStats& instanceStats = InstanceBuffer::GetFrameStats();
+	ImGui::Text("Instance uploads: %zu ranges, %.1f KB", instanceStats.Ranges, instanceStats.Bytes / 1024.0);
+	// Show how many times we set a uniform without asking the driver where it was
+	const ShaderUniformStats& uniformStats = Shader::GetFrameStats();
+	ImGui::Text("Uniforms: %zu driver lookups avoided (%zu by name)", uniformStats.LookupsAvoided, uniformStats.NameLookups);
+	// Show how long our shaders took to start up, warm ones came from the program binary cache
+	const ShaderCacheStats& shaderStats = ShaderCache::GetStats();
+	ImGui::Text("Shader init: %zu warm (%.1f ms), %zu cold (%.1f ms), %zu compiling%s", shaderStats.Hits, shaderStats.WarmMs,
+		shaderStats.Misses, shaderStats.ColdMs, Shader::GetPendingCount(), Shader::SupportsParallelCompile() ? " in parallel" : "");
+
+	// Show how full each of our geometry arenas is, and how broken up their free space has become
+	if (ImGui::CollapsingHeader("Geometry Arenas")) {
+		for (const GeometryArena* arena : GeometryArena::GetArenas()) {
+			GeometryArenaStats arenaStats = arena->GetStats();
+			ImGui::Text("%s: %zu meshes in %zu pages", arena->DebugName.c_str(), arenaStats.Allocations, arenaStats.Pages);
+			ImGui::Text("\tVertices: %.1f of %.1f KB reserved, indices: %.1f of %.1f KB reserved",
+				arenaStats.VertexUsed / 1024.0, arenaStats.VertexReserved / 1024.0,
+				arenaStats.IndexUsed / 1024.0, arenaStats.IndexReserved / 1024.0);
+			ImGui::Text("\tFragmentation: %.1f%% (%zu free ranges)", arenaStats.Fragmentation * 100.0f, arenaStats.FreeRanges);
+		}
+	}
+
+	// Let us recolor a single instance, which only sends that one instance to the GPU
+	if (ImGui::CollapsingHeader("Instances")) {
+		auto& ecs = CurrentRegistry();
+		for (const auto& entity : ecs.view<InstancedMeshRenderer>()) {
+			InstancedMeshRenderer& renderer = ecs.get<InstancedMeshRenderer>(entity);
+			if (renderer.Instances == nullptr || renderer.Instances->GetCount() == 0)
+				continue;
+			ImGui::PushID(static_cast<int>(entity));
+			static int selected = 0;
+			selected = glm::min(selected, static_cast<int>(renderer.Instances->GetCount()) - 1);
+			ImGui::Text("%zu instances", renderer.Instances->GetCount());
+			ImGui::SliderInt("Instance", &selected, 0, static_cast<int>(renderer.Instances->GetCount()) - 1);
+			glm::vec4 color = renderer.Instances->Get(selected).Color;
+			if (ImGui::ColorEdit4("Instance Color", &color[0]))
+				renderer.Instances->SetColor(selected, color);
+			ImGui::PopID();
+		}
+	}
+
+	// Let us tune how much error our LODs can show, and see what each level costs
+	if (ImGui::CollapsingHeader("LOD Settings")) {
+		auto& ecs = CurrentRegistry();
+		for (const auto& entity : ecs.view<LodGroup>()) {
+			LodGroup& lods = ecs.get<LodGroup>(entity);
+			ImGui::PushID(static_cast<int>(entity));
+			ImGui::DragFloat("Max screen error (px)", &lods.MaxScreenError, 0.1f, 0.1f, 32.0f);
+			for (size_t ix = 0; ix < lods.Levels.size(); ix++)
+				ImGui::Text("LOD %zu: %zu triangles, error %.4f", ix, lods.Levels[ix].Mesh->GetIndexCount() / 3, lods.Levels[ix].Error);
+			ImGui::PopID();
+		}
+	}
 
 	// Start a new ImGui header for our camera settings
 	if (ImGui::CollapsingHeader("Camera Settings")) {
@@ -712,6 +1057,9 @@ void Game::_RenderScene(glm::ivec4 viewport, Camera::Sptr camera)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
+	// Every shader reads this viewport's camera from the shared view block
+	mySceneUniforms->SetView(camera->GetView(), camera->Projection, camera->GetPosition());
+
 	// We'll grab a reference to the ecs to make things easier
 	auto& ecs = CurrentRegistry();
 
@@ -733,10 +1081,42 @@ void Game::_RenderScene(glm::ivec4 viewport, Camera::Sptr camera)
 		});
 
 
+	// The uniforms we set for every entity, we look their IDs up once so that we don't have to hash their names each time
+	static const Shader::UniformId ModelViewProjectionId = Shader::GetUniformId("a_ModelViewProjection");
+	static const Shader::UniformId ModelId               = Shader::GetUniformId("a_Model");
+	static const Shader::UniformId NormalMatrixId        = Shader::GetUniformId("a_NormalMatrix");
+
 	// These will keep track of the current shader and material that we have bound
 	Material::Sptr mat = nullptr;
 	Shader::Sptr boundShader = nullptr;
 
+	// Instanced renderers draw every one of their instances with a single call. They follow the same order as our
+	// mesh renderers, so we draw the opaque ones right before the first transparent mesh and the rest at the end
+	bool drawnOpaqueInstances = false;
+	auto drawInstanced = [&](bool transparent) {
+		for (const auto& entity : ecs.view<InstancedMeshRenderer>()) {
+			const InstancedMeshRenderer& renderer = ecs.get<InstancedMeshRenderer>(entity);
+			if (renderer.Mesh == nullptr || renderer.Material == nullptr || renderer.Instances == nullptr || renderer.Instances->GetCount() == 0)
+				continue;
+			if (renderer.Material->HasTransparency != transparent)
+				continue;
+
+			// Our instances can't be drawn without the shader that reads them, so we skip them until it's ready
+			const Shader::Sptr& shader = renderer.Material->GetShader();
+			if (!shader->IsReady())
+				continue;
+			shader->Bind();
+			// Each instance's transform is relative to the entity's
+			shader->SetUniform(ModelId, ecs.get_or_assign<Transform>(entity).GetWorldTransform());
+			renderer.Material->Apply();
+
+			// Only the instances that changed since the last upload get sent, so the other viewports send nothing
+			renderer.Instances->Upload();
+			renderer.Instances->Bind();
+			renderer.Mesh->DrawInstanced(renderer.Instances->GetCount());
+		}
+	};
+
 	// A view will let us iterate over all of our entities that have the given component types
 	auto view = ecs.view<MeshRenderer>();
 
@@ -749,19 +1129,33 @@ void Game::_RenderScene(glm::ivec4 viewport, Camera::Sptr camera)
 		if (renderer.Mesh == nullptr || renderer.Material == nullptr)
 			continue;
 
-		// If our shader has changed, we need to bind it and update our frame-level uniforms
-		if (renderer.Material->GetShader() != boundShader) {
-			boundShader = renderer.Material->GetShader();
-			boundShader->Bind();
-			boundShader->SetUniform("a_CameraPos", camera->GetPosition());
-			boundShader->SetUniform("a_Time", static_cast<float>(glfwGetTime()));
+		// Our meshes are sorted with the transparent ones last, so this is where the opaque instances go
+		if (renderer.Material->HasTransparency && !drawnOpaqueInstances) {
+			myDrawBatcher->Flush();
+			drawInstanced(false);
+			drawnOpaqueInstances = true;
+			// The instances bound their own shaders and materials
+			boundShader = nullptr;
+			mat = nullptr;
+		}
+
+		// Materials whose shader is still compiling get drawn with the fallback shader in the meantime
+		const Shader::Sptr& shader = renderer.Material->GetShader()->IsReady() ? renderer.Material->GetShader() : myFallbackShader;
 
+		// If our shader has changed, we need to bind it, the frame and view blocks are already bound for it
+		if (shader != boundShader) {
+			// Anything we batched up so far was meant for the old shader
+			myDrawBatcher->Flush();
+			boundShader = shader;
+			boundShader->Bind();
 		}
 
-		// If our material has changed, we need to apply it to the shader
+		// If our material has changed, we need to apply it to the shader (the fallback shader has nothing to apply)
 		if (renderer.Material != mat) {
+			myDrawBatcher->Flush();
 			mat = renderer.Material;
-			mat->Apply();
+			if (boundShader != myFallbackShader)
+				mat->Apply();
 		}
 
 		// We'll need some info about the entities position in the world
@@ -777,25 +1171,65 @@ void Game::_RenderScene(glm::ivec4 viewport, Camera::Sptr camera)
 		// Our normal matrix is the inverse-transpose of our object's world rotation
 		glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(worldTransform)));
 
+		// Draw a simpler version of the mesh if this camera sees it small enough not to notice
+		Mesh::Sptr mesh = renderer.Mesh;
+		const LodGroup* lods = ecs.try_get<LodGroup>(entity);
+		if (lods != nullptr && !lods->Levels.empty()) {
+			size_t level = lods->Select(worldTransform, camera->GetView(), camera->Projection, static_cast<float>(viewport.w - 2 * border));
+			mesh = lods->Levels[level].Mesh;
+		}
+
+		// Skip the parts of the mesh that this camera can't see if it has been split into meshlets
+		static std::vector<MeshletRange> ranges;
+		bool hasMeshlets = !mesh->GetMeshlets().empty();
+		if (hasMeshlets) {
+			MeshletCullView cullView = MeshletCullView::Create(worldTransform, camera->GetView(), camera->Projection);
+			MeshletCuller::Cull(mesh->GetMeshlets(), cullView, ranges, &myMeshletStats);
+		}
+
+		// Shaders that read their transforms from a storage buffer get drawn in batches, until the shader or material changes
+		if (boundShader->SupportsBatching() && mesh->GetIndexCount() > 0) {
+			DrawObject object;
+			object.Model        = worldTransform;
+			object.NormalMatrix = glm::mat4(normalMatrix);
+			myDrawBatcher->Submit(mesh, object, hasMeshlets ? &ranges : nullptr);
+			continue;
+		}
+
+		// The fallback shader only reads batched transforms, so anything else waits for its own shader
+		if (boundShader == myFallbackShader)
+			continue;
+
+		// Shaders that can't be batched still get their transforms as loose uniforms
 		// Update the MVP using the item's transform
-		mat->GetShader()->SetUniform(
-			"a_ModelViewProjection",
+		boundShader->SetUniform(
+			ModelViewProjectionId,
 			camera->GetViewProjection() *
 			worldTransform);
 
 		// Update the model matrix to the item's world transform
-		mat->GetShader()->SetUniform("a_Model", worldTransform);
+		boundShader->SetUniform(ModelId, worldTransform);
 
 		// Update the model matrix to the item's world transform
-		mat->GetShader()->SetUniform("a_NormalMatrix", normalMatrix);
+		boundShader->SetUniform(NormalMatrixId, normalMatrix);
 
 		// Draw the item
-		renderer.Mesh->Draw();
+		if (hasMeshlets)
+			mesh->DrawRanges(ranges);
+		else
+			mesh->Draw();
 	}
+	// Draw whatever is left in the last batch
+	myDrawBatcher->Flush();
+
+	// Opaque instances still have to go in before anything transparent, so that they show through it
+	if (!drawnOpaqueInstances)
+		drawInstanced(false);
+	drawInstanced(true);
 
 	auto scene = CurrentScene();
 	// Draw the skybox after everything else, if the scene has one
-	if (scene->Skybox)
+	if (scene->Skybox && scene->SkyboxShader->IsReady())
 	{
 		// Disable culling
 		glDisable(GL_CULL_FACE);
@@ -807,11 +1241,8 @@ void Game::_RenderScene(glm::ivec4 viewport, Camera::Sptr camera)
 		// Make sure no samplers are bound to slot 0
 		TextureSampler::Unbind(0);
 		// Set up the shader
+		// The skybox takes its view and projection from the view block, like everything else
 		scene->SkyboxShader->Bind();
-		scene->SkyboxShader->SetUniform("a_View", glm::mat4(glm::mat3(
-			camera->GetView()
-		)));
-		scene->SkyboxShader->SetUniform("a_Projection", camera->Projection);
 
 		scene->Skybox->Bind(0);
 		scene->SkyboxShader->SetUniform("s_Skybox", 0);
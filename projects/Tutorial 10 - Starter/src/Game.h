@@ -12,6 +12,10 @@
 #include "Mesh.h"
 #include "Shader.h"
 #include "Camera.h"
+#include "AssetLoader.h"
+#include "ResourceCache.h"
+#include "DrawBatcher.h"
+#include "SceneUniforms.h"
 
 class Game {
 public:
@@ -58,4 +62,21 @@ private:
 
 	// Our models transformation matrix
 	glm::mat4   myModelTransform;
+
+	// Loads our assets in the background, and uploads them during our frames
+	AssetLoader::Sptr myAssetLoader;
+	// Makes sure that we only load one copy of each texture, mesh and shader
+	ResourceCache::Sptr myResources;
+	// How many meshlets were culled while drawing the last frame
+	MeshletCullStats myMeshletStats;
+	// Collects the draws for entities that share a shader and material
+	DrawBatcher::Sptr myDrawBatcher;
+	// The uniform blocks shared by every shader, for the frame and for each viewport
+	SceneUniforms::Sptr mySceneUniforms;
+	// Draws anything whose own shader is still being compiled
+	Shader::Sptr myFallbackShader;
+	// The longest we will spend creating loaded assets in a single frame
+	static constexpr double AssetUploadBudgetMs = 2.0;
+	// The longest we will spend finishing shaders in a single frame, when the driver can't compile them in parallel
+	static constexpr double ShaderFinishBudgetMs = 2.0;
 };
\ No newline at end of file
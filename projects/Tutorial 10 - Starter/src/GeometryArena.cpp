@@ -0,0 +1,207 @@
+#include "GeometryArena.h"
+#include "Logging.h"
+
+#include <algorithm>
+
+FreeListAllocator::FreeListAllocator(size_t capacity) :
+	myCapacity(capacity),
+	myFreeSize(capacity)
+{
+	if (capacity > 0)
+		myFreeRanges[0] = capacity;
+}
+
+size_t FreeListAllocator::Allocate(size_t size, size_t alignment) {
+	if (size == 0)
+		return 0;
+
+	// Find the smallest range that can fit the allocation once it has been aligned
+	auto best = myFreeRanges.end();
+	size_t bestPadding = 0;
+	for (auto it = myFreeRanges.begin(); it != myFreeRanges.end(); it++) {
+		size_t padding = (alignment - it->first % alignment) % alignment;
+		if (it->second >= size + padding && (best == myFreeRanges.end() || it->second < best->second)) {
+			best = it;
+			bestPadding = padding;
+			if (it->second == size + padding)
+				break;
+		}
+	}
+	if (best == myFreeRanges.end())
+		return Invalid;
+
+	size_t rangeOffset = best->first;
+	size_t rangeSize   = best->second;
+	size_t offset      = rangeOffset + bestPadding;
+	myFreeRanges.erase(best);
+	// Give back whatever we didn't use on either side of the allocation
+	if (bestPadding > 0)
+		myFreeRanges[rangeOffset] = bestPadding;
+	if (rangeSize > size + bestPadding)
+		myFreeRanges[offset + size] = rangeSize - size - bestPadding;
+	myFreeSize -= size;
+	return offset;
+}
+
+void FreeListAllocator::Free(size_t offset, size_t size) {
+	if (size == 0)
+		return;
+	myFreeSize += size;
+
+	// Merge with the free ranges on either side of us, if they touch
+	auto next = myFreeRanges.lower_bound(offset);
+	if (next != myFreeRanges.end() && offset + size == next->first) {
+		size += next->second;
+		next = myFreeRanges.erase(next);
+	}
+	if (next != myFreeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+	myFreeRanges[offset] = size;
+}
+
+size_t FreeListAllocator::GetLargestFree() const {
+	size_t result = 0;
+	for (const auto& range : myFreeRanges)
+		result = std::max(result, range.second);
+	return result;
+}
+
+GLuint                      GeometryArena::_BoundVao = 0;
+GeometryArenaFrameStats     GeometryArena::_FrameStats;
+std::vector<GeometryArena*> GeometryArena::_Arenas;
+
+GeometryArena::GeometryArena(GLsizei stride, void(*applyLayout)(size_t)) :
+	myStride(stride),
+	myApplyLayout(applyLayout),
+	myAllocationCount(0),
+	myNextPageVertexBytes(MinPageVertexBytes),
+	myNextPageIndexBytes(MinPageIndexBytes)
+{
+	_Arenas.push_back(this);
+}
+
+GeometryArena::~GeometryArena() {
+	for (Page& page : myPages) {
+		if (_BoundVao == page.Vao)
+			_BoundVao = 0;
+		glDeleteBuffers(2, page.Buffers);
+		glDeleteVertexArrays(1, &page.Vao);
+	}
+	_Arenas.erase(std::remove(_Arenas.begin(), _Arenas.end(), this), _Arenas.end());
+}
+
+size_t GeometryArena::__AddPage(size_t vertexCount, size_t indexBytes) {
+	Page page;
+	size_t vertexCapacity = std::max(vertexCount, myNextPageVertexBytes / myStride);
+	size_t indexCapacity  = std::max(indexBytes, myNextPageIndexBytes);
+	// Each page is twice the size of the last, so that we only reserve a lot of memory once we know we need it.
+	// Meshes that needed a bigger page than that don't count, so a small mesh after a huge one gets a small page
+	myNextPageVertexBytes = std::min(myNextPageVertexBytes * 2, MaxPageVertexBytes);
+	myNextPageIndexBytes  = std::min(myNextPageIndexBytes * 2, MaxPageIndexBytes);
+	page.Vertices = FreeListAllocator(vertexCapacity);
+	page.Indices  = FreeListAllocator(indexCapacity);
+
+	// The buffers never get resized, so we can use immutable storage and fill them in with glNamedBufferSubData
+	glCreateBuffers(2, page.Buffers);
+	glNamedBufferStorage(page.Buffers[0], vertexCapacity * myStride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(page.Buffers[1], indexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	// Our layouts are set up with glVertexAttribPointer, which reads from whatever is bound to GL_ARRAY_BUFFER
+	glCreateVertexArrays(1, &page.Vao);
+	glBindVertexArray(page.Vao);
+	glBindBuffer(GL_ARRAY_BUFFER, page.Buffers[0]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.Buffers[1]);
+	myApplyLayout(0);
+	glBindVertexArray(0);
+	_BoundVao = 0;
+
+	LOG_TRACE("Added page {} to geometry arena '{}' ({:.1f} KB of vertices, {:.1f} KB of indices)", myPages.size(), DebugName,
+		vertexCapacity * myStride / 1024.0, indexCapacity / 1024.0);
+	myPages.push_back(page);
+	return myPages.size() - 1;
+}
+
+GeometryArena::Allocation GeometryArena::Allocate(const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes) {
+	Allocation result;
+	result.VertexCount = vertexCount;
+	result.IndexBytes  = indexBytes;
+
+	// Both halves of the mesh have to land in the same page, since they get drawn with the same VAO
+	size_t pageIx = 0;
+	for (; pageIx <= myPages.size(); pageIx++) {
+		if (pageIx == myPages.size())
+			__AddPage(vertexCount, indexBytes);
+		Page& page = myPages[pageIx];
+		size_t vertexOffset = page.Vertices.Allocate(vertexCount);
+		if (vertexOffset == FreeListAllocator::Invalid)
+			continue;
+		// Offsets into the index buffer need to be aligned to the size of the largest index type
+		size_t indexOffset = page.Indices.Allocate(indexBytes, sizeof(uint32_t));
+		if (indexOffset == FreeListAllocator::Invalid) {
+			page.Vertices.Free(vertexOffset, vertexCount);
+			continue;
+		}
+		result.Page        = pageIx;
+		result.BaseVertex  = static_cast<GLint>(vertexOffset);
+		result.IndexOffset = indexOffset;
+		break;
+	}
+
+	const Page& page = myPages[result.Page];
+	if (vertexCount > 0)
+		glNamedBufferSubData(page.Buffers[0], result.BaseVertex * (GLintptr)myStride, vertexCount * myStride, vertices);
+	if (indexBytes > 0)
+		glNamedBufferSubData(page.Buffers[1], result.IndexOffset, indexBytes, indices);
+	myAllocationCount++;
+	return result;
+}
+
+void GeometryArena::Free(const Allocation& allocation) {
+	Page& page = myPages[allocation.Page];
+	page.Vertices.Free(allocation.BaseVertex, allocation.VertexCount);
+	page.Indices.Free(allocation.IndexOffset, allocation.IndexBytes);
+	myAllocationCount--;
+}
+
+void GeometryArena::Bind(size_t page) {
+	GLuint vao = myPages[page].Vao;
+	if (vao == _BoundVao) {
+		_FrameStats.BindsSaved++;
+		return;
+	}
+	glBindVertexArray(vao);
+	_BoundVao = vao;
+	_FrameStats.Binds++;
+}
+
+GeometryArenaStats GeometryArena::GetStats() const {
+	GeometryArenaStats result;
+	result.Pages       = myPages.size();
+	result.Allocations = myAllocationCount;
+	size_t vertexFree = 0, vertexLargest = 0, indexFree = 0, indexLargest = 0;
+	for (const Page& page : myPages) {
+		result.VertexReserved += page.Vertices.GetCapacity() * myStride;
+		result.IndexReserved  += page.Indices.GetCapacity();
+		result.FreeRanges  += page.Vertices.GetFreeRangeCount() + page.Indices.GetFreeRangeCount();
+		vertexFree    += page.Vertices.GetFreeSize();
+		indexFree     += page.Indices.GetFreeSize();
+		vertexLargest  = std::max(vertexLargest, page.Vertices.GetLargestFree());
+		indexLargest   = std::max(indexLargest, page.Indices.GetLargestFree());
+	}
+	result.VertexUsed = result.VertexReserved - vertexFree * myStride;
+	result.IndexUsed  = result.IndexReserved - indexFree;
+	float vertexFragmentation = vertexFree > 0 ? 1.0f - (float)vertexLargest / vertexFree : 0.0f;
+	float indexFragmentation  = indexFree > 0 ? 1.0f - (float)indexLargest / indexFree : 0.0f;
+	result.Fragmentation = std::max(vertexFragmentation, indexFragmentation);
+	return result;
+}
+
+void GeometryArena::BeginFrame() {
+	_FrameStats = GeometryArenaFrameStats();
+	_BoundVao   = 0;
+}
@@ -0,0 +1,207 @@
+/*
+	Shared vertex and index buffers for every mesh of a vertex layout. Instead of each mesh owning a VAO and two
+	buffers, meshes sub-allocate ranges of a few large pages, and draw with glDrawElementsBaseVertex so that their
+	indices don't need to know where their vertices ended up. Meshes that share a page share a VAO, which lets us
+	skip rebinding it between draws
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include "Utils.h"
+#include "VertexLayout.h"
+
+/*
+ * Hands out ranges of a fixed size space, keeping the free ranges sorted by offset so that neighbours get merged
+ * back together as soon as they are both free. Allocations take the smallest free range that fits them, which
+ * keeps the large ranges around for large meshes
+ */
+class FreeListAllocator {
+public:
+	// Returned by Allocate when there is no free range large enough
+	static constexpr size_t Invalid = ~(size_t)0;
+
+	FreeListAllocator(size_t capacity = 0);
+
+	/*
+	 * Finds space for a range
+	 * @param size      The size of the range, in whatever units the allocator was created with
+	 * @param alignment The offset of the range will be a multiple of this
+	 * @returns The offset of the range, or Invalid if there was no room
+	 */
+	size_t Allocate(size_t size, size_t alignment = 1);
+	/*
+	 * Returns a range given out by Allocate
+	 */
+	void Free(size_t offset, size_t size);
+
+	// Gets the total size of the space we are handing out
+	size_t GetCapacity() const { return myCapacity; }
+	// Gets the size of all of the free ranges together
+	size_t GetFreeSize() const { return myFreeSize; }
+	// Gets the size of the largest free range
+	size_t GetLargestFree() const;
+	// Gets the number of separate free ranges
+	size_t GetFreeRangeCount() const { return myFreeRanges.size(); }
+
+private:
+	size_t myCapacity;
+	size_t myFreeSize;
+	// The offset of each free range, mapped to its size
+	std::map<size_t, size_t> myFreeRanges;
+};
+
+/*
+ * The space used by a single arena, summed over all of its pages
+ */
+struct GeometryArenaStats {
+	size_t Pages          = 0;
+	size_t Allocations    = 0;
+	// The bytes of GPU memory that our pages have reserved, and how many of them meshes are using
+	size_t VertexReserved = 0;
+	size_t VertexUsed     = 0;
+	size_t IndexReserved  = 0;
+	size_t IndexUsed      = 0;
+	// The number of separate free ranges, in the vertex and index buffers
+	size_t FreeRanges     = 0;
+	/*
+	 * How broken up the free space is, from 0 (all of it is in a single range) to close to 1 (it is all in tiny
+	 * pieces). This is 1 minus the largest free range over the total free space, worst of vertices and indices
+	 */
+	float  Fragmentation  = 0.0f;
+
+	// Gets the total GPU memory that the arena has reserved
+	size_t GetReservedBytes() const { return VertexReserved + IndexReserved; }
+	// Gets the total GPU memory that meshes are using
+	size_t GetUsedBytes() const { return VertexUsed + IndexUsed; }
+};
+
+/*
+ * The drawing done through every arena since the last call to GeometryArena::BeginFrame
+ */
+struct GeometryArenaFrameStats {
+	size_t Draws      = 0;
+	// The number of times we had to bind a VAO
+	size_t Binds      = 0;
+	// The number of times the VAO we needed was already bound, so we could skip binding it
+	size_t BindsSaved = 0;
+};
+
+class GeometryArena {
+public:
+	GraphicsClass(GeometryArena);
+
+	/*
+	 * Where a mesh's data ended up in an arena
+	 */
+	struct Allocation {
+		// The page that the data is in
+		size_t   Page        = 0;
+		// The first vertex of the mesh in the page's vertex buffer, passed as the base vertex when drawing
+		GLint    BaseVertex  = 0;
+		size_t   VertexCount = 0;
+		// The offset in bytes of the mesh's indices in the page's index buffer
+		size_t   IndexOffset = 0;
+		size_t   IndexBytes  = 0;
+	};
+
+	/*
+	 * Creates a new arena for a vertex layout. Most code should use GetShared instead, so that meshes with the
+	 * same layout all end up in the same buffers
+	 * @param stride      The size of a single vertex in bytes
+	 * @param applyLayout Sets up the vertex attributes on a bound VAO (ex: VertexLayoutOf<Vertex>::Apply)
+	 */
+	GeometryArena(GLsizei stride, void(*applyLayout)(size_t));
+	~GeometryArena();
+
+	/*
+	 * Copies a mesh's data into the arena, adding a new page if none of the existing ones have room
+	 * @param vertices   The vertex data, vertexCount * stride bytes
+	 * @param indices    The index data, either 16 or 32 bit
+	 * @param indexBytes The size of the index data in bytes
+	 */
+	Allocation Allocate(const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes);
+	/*
+	 * Releases the space used by an allocation, so that other meshes can use it
+	 */
+	void Free(const Allocation& allocation);
+
+	/*
+	 * Binds the VAO for a page, if it isn't bound already
+	 */
+	void Bind(size_t page);
+
+	// Gets the size of a single vertex in this arena, in bytes
+	GLsizei GetStride() const { return myStride; }
+	// Gets how much of this arena's space is being used
+	GeometryArenaStats GetStats() const;
+
+	/*
+	 * Gets the arena shared by all meshes with the given vertex type. Arenas only stay alive while meshes are using them
+	 */
+	template <typename TVertex>
+	static Sptr GetShared() {
+		static std::weak_ptr<GeometryArena> shared;
+		Sptr result = shared.lock();
+		if (result == nullptr) {
+			result = std::make_shared<GeometryArena>(VertexLayoutOf<TVertex>::Stride, &VertexLayoutOf<TVertex>::Apply);
+			result->DebugName = typeid(TVertex).name();
+			shared = result;
+		}
+		return result;
+	}
+
+	/*
+	 * Resets the frame statistics, and forgets which VAO is bound. This should be called at the start of each
+	 * frame, since other code (ex: ImGui) binds its own VAOs
+	 */
+	static void BeginFrame();
+	// Gets the drawing statistics since the last call to BeginFrame
+	static const GeometryArenaFrameStats& GetFrameStats() { return _FrameStats; }
+	// Notes that a draw was made from an arena, for the frame statistics
+	static void CountDraw() { _FrameStats.Draws++; }
+	// Gets every arena that is currently alive
+	static const std::vector<GeometryArena*>& GetArenas() { return _Arenas; }
+
+	/*
+	 * The sizes of each page's buffers. The first page of an arena starts at the minimum (or the size of the mesh
+	 * that needed it, if that is bigger), and every page after it is twice the size of the last, up to the maximum.
+	 * This way a layout with a handful of small meshes only reserves a little memory. Meshes larger than the
+	 * maximum get a page of their own
+	 */
+	static constexpr size_t MinPageVertexBytes = 64 * 1024;
+	static constexpr size_t MinPageIndexBytes  = 32 * 1024;
+	static constexpr size_t MaxPageVertexBytes = 32 * 1024 * 1024;
+	static constexpr size_t MaxPageIndexBytes  = 16 * 1024 * 1024;
+
+private:
+	struct Page {
+		GLuint            Vao;
+		// 0 is vertices, 1 is indices
+		GLuint            Buffers[2];
+		// Vertices are allocated in units of vertices, indices in bytes
+		FreeListAllocator Vertices;
+		FreeListAllocator Indices;
+	};
+
+	// Creates a new page that can hold at least the given amount of data
+	size_t __AddPage(size_t vertexCount, size_t indexBytes);
+
+	GLsizei                myStride;
+	void(*myApplyLayout)(size_t);
+	std::vector<Page>      myPages;
+	size_t                 myAllocationCount;
+	// The size of the next page we add, unless the mesh that needs it is bigger
+	size_t                 myNextPageVertexBytes;
+	size_t                 myNextPageIndexBytes;
+
+	// The VAO that we last bound, shared by all arenas
+	static GLuint                      _BoundVao;
+	static GeometryArenaFrameStats     _FrameStats;
+	static std::vector<GeometryArena*> _Arenas;
+};
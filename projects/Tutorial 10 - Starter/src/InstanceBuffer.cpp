@@ -0,0 +1,109 @@
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+
+// Dirty ranges that are at most this many instances apart get uploaded together, since a few extra bytes
+// are cheaper than another call
+static const size_t MergeGap = 4;
+
+InstanceUploadStats InstanceBuffer::_FrameStats;
+
+InstanceBuffer::InstanceBuffer(size_t capacity) :
+	myCapacity(std::max(capacity, (size_t)1))
+{
+	glCreateBuffers(1, &myBuffer);
+	glNamedBufferData(myBuffer, myCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+	glDeleteBuffers(1, &myBuffer);
+}
+
+void InstanceBuffer::__MarkDirty(size_t index) {
+	// Most updates walk through the instances in order, so we try to grow the last range first
+	if (!myDirtyRanges.empty()) {
+		std::pair<size_t, size_t>& last = myDirtyRanges.back();
+		if (index >= last.first && index < last.second)
+			return;
+		if (index == last.second) {
+			last.second++;
+			return;
+		}
+	}
+	myDirtyRanges.push_back({ index, index + 1 });
+}
+
+size_t InstanceBuffer::Add(const glm::mat4& transform, const glm::vec4& color) {
+	myInstances.push_back({ transform, color });
+	__MarkDirty(myInstances.size() - 1);
+	return myInstances.size() - 1;
+}
+
+void InstanceBuffer::Remove(size_t index) {
+	if (index != myInstances.size() - 1) {
+		myInstances[index] = myInstances.back();
+		__MarkDirty(index);
+	}
+	myInstances.pop_back();
+}
+
+void InstanceBuffer::Clear() {
+	myInstances.clear();
+	myDirtyRanges.clear();
+}
+
+void InstanceBuffer::SetTransform(size_t index, const glm::mat4& transform) {
+	myInstances[index].Transform = transform;
+	__MarkDirty(index);
+}
+
+void InstanceBuffer::SetColor(size_t index, const glm::vec4& color) {
+	myInstances[index].Color = color;
+	__MarkDirty(index);
+}
+
+void InstanceBuffer::Upload() {
+	size_t count = myInstances.size();
+
+	// If we've outgrown the buffer we need a new one anyways, so we send everything at once
+	if (count > myCapacity) {
+		myCapacity = std::max(count, myCapacity * 2);
+		glNamedBufferData(myBuffer, myCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+		glNamedBufferSubData(myBuffer, 0, count * sizeof(InstanceData), myInstances.data());
+		myDirtyRanges.clear();
+		_FrameStats.Ranges++;
+		_FrameStats.Bytes += count * sizeof(InstanceData);
+		return;
+	}
+	if (myDirtyRanges.empty())
+		return;
+
+	// Sort and merge our ranges so that every instance is sent once, in as few calls as we can
+	std::sort(myDirtyRanges.begin(), myDirtyRanges.end());
+	size_t begin = myDirtyRanges[0].first;
+	size_t end   = myDirtyRanges[0].second;
+	auto send = [&](size_t from, size_t to) {
+		// Removing instances can leave ranges past the end of the list behind, there's nothing to send for those
+		to = std::min(to, count);
+		if (from >= to)
+			return;
+		glNamedBufferSubData(myBuffer, from * sizeof(InstanceData), (to - from) * sizeof(InstanceData), myInstances.data() + from);
+		_FrameStats.Ranges++;
+		_FrameStats.Bytes += (to - from) * sizeof(InstanceData);
+	};
+	for (size_t ix = 1; ix < myDirtyRanges.size(); ix++) {
+		if (myDirtyRanges[ix].first <= end + MergeGap)
+			end = std::max(end, myDirtyRanges[ix].second);
+		else {
+			send(begin, end);
+			begin = myDirtyRanges[ix].first;
+			end   = myDirtyRanges[ix].second;
+		}
+	}
+	send(begin, end);
+	myDirtyRanges.clear();
+}
+
+void InstanceBuffer::Bind(GLuint binding) const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, myBuffer);
+}
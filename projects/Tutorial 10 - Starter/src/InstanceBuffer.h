@@ -0,0 +1,94 @@
+/*
+	A dense, growable list of per-instance data for drawing the same mesh many times in one call. The data lives
+	in a shader storage buffer that instanced shaders read with gl_InstanceID:
+
+		struct Instance { mat4 Transform; vec4 Color; };
+		layout(std430, binding = 1) readonly buffer InstanceData { Instance a_Instances[]; };
+
+	Changes are tracked as dirty ranges, so that only the instances that changed get uploaded again
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <utility>
+#include <vector>
+#include "Utils.h"
+
+/*
+ * The data for a single instance, laid out to match the std430 Instance struct above
+ */
+struct InstanceData {
+	glm::mat4 Transform;
+	glm::vec4 Color;
+};
+
+/*
+ * What every InstanceBuffer has sent to the GPU since the last call to InstanceBuffer::BeginFrame
+ */
+struct InstanceUploadStats {
+	// The number of glNamedBufferSubData calls (or 1 if the buffer had to be reallocated)
+	size_t Ranges = 0;
+	size_t Bytes  = 0;
+};
+
+class InstanceBuffer {
+public:
+	GraphicsClass(InstanceBuffer);
+
+	/*
+	 * Creates a new instance buffer
+	 * @param capacity The number of instances to make room for on the GPU up front
+	 */
+	InstanceBuffer(size_t capacity = 64);
+	~InstanceBuffer();
+
+	/*
+	 * Adds an instance to the end of the list
+	 * @returns The index of the new instance
+	 */
+	size_t Add(const glm::mat4& transform, const glm::vec4& color = glm::vec4(1.0f));
+	/*
+	 * Removes an instance by moving the last instance into its place, which keeps the list dense. This means that
+	 * the index of the last instance changes to the index that was removed
+	 */
+	void Remove(size_t index);
+	// Removes every instance
+	void Clear();
+
+	void SetTransform(size_t index, const glm::mat4& transform);
+	void SetColor(size_t index, const glm::vec4& color);
+	const InstanceData& Get(size_t index) const { return myInstances[index]; }
+	size_t GetCount() const { return myInstances.size(); }
+
+	/*
+	 * Sends the instances that have changed since the last upload to the GPU, growing the buffer if there are
+	 * more instances than it can hold. This is cheap to call when nothing has changed
+	 */
+	void Upload();
+	/*
+	 * Binds the buffer to a shader storage binding point
+	 */
+	void Bind(GLuint binding = DefaultBinding) const;
+
+	// Resets the upload statistics, this should be called at the start of each frame
+	static void BeginFrame() { _FrameStats = InstanceUploadStats(); }
+	// Gets what has been uploaded since the last call to BeginFrame
+	static const InstanceUploadStats& GetFrameStats() { return _FrameStats; }
+
+	// The binding point of the InstanceData storage block in our instanced shaders
+	static constexpr GLuint DefaultBinding = 1;
+
+private:
+	// Notes that an instance needs to be uploaded again
+	void __MarkDirty(size_t index);
+
+	GLuint                                 myBuffer;
+	// The number of instances the GPU buffer can hold
+	size_t                                 myCapacity;
+	std::vector<InstanceData>              myInstances;
+	// The [begin, end) ranges of instances that have changed, these may overlap until we upload
+	std::vector<std::pair<size_t, size_t>> myDirtyRanges;
+
+	static InstanceUploadStats _FrameStats;
+};
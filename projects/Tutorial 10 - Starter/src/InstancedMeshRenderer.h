@@ -0,0 +1,15 @@
+#pragma once
+#include "Material.h"
+#include "Mesh.h"
+#include "InstanceBuffer.h"
+
+/*
+ * Draws the same mesh many times with a single glDrawElementsInstanced call. The material's shader reads each
+ * instance's transform (relative to the entity's Transform) and color from the InstanceData storage block, see
+ * instanced.vs.glsl
+ */
+struct InstancedMeshRenderer {
+	Material::Sptr       Material;
+	Mesh::Sptr           Mesh;
+	InstanceBuffer::Sptr Instances;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+#include "Mesh.h"
+
+/*
+ * Lets an entity draw simpler versions of its MeshRenderer's mesh as it gets smaller on screen. Each level knows
+ * how far its surface strays from the full mesh, and we draw the simplest level whose error would cover less
+ * than MaxScreenError pixels for the camera we are drawing with
+ */
+struct LodGroup {
+	struct Level {
+		Mesh::Sptr Mesh;
+		// The error of this level in model space units, see MeshLodLevel
+		float      Error;
+	};
+
+	// The levels to choose from, starting with the full detail mesh
+	std::vector<Level> Levels;
+	// The bounding sphere of the mesh in model space
+	glm::vec3 Center = glm::vec3(0.0f);
+	float     Radius = 0.0f;
+	// The largest error we are willing to see on screen, in pixels
+	float     MaxScreenError = 1.0f;
+
+	/*
+	 * Picks the level to draw for a camera
+	 * @param world          The world transform of the entity
+	 * @param view           The camera's view matrix
+	 * @param projection     The camera's projection matrix, perspective and orthographic are both supported
+	 * @param viewportHeight The height of the viewport we are drawing to, in pixels
+	 * @returns The index of the level to draw
+	 */
+	size_t Select(const glm::mat4& world, const glm::mat4& view, const glm::mat4& projection, float viewportHeight) const {
+		if (Levels.size() < 2)
+			return 0;
+
+		// Errors scale with the object, we go with the largest axis so that we never under estimate them
+		float scale = glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+
+		// projection[1][1] maps view space units to NDC at a distance of 1 for perspective, or everywhere for
+		// orthographic, and the viewport covers 2 NDC units
+		float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f * scale;
+		bool isPerspective = projection[2][3] != 0.0f;
+		if (isPerspective) {
+			// The closest point of the bounding sphere is where the error would be the most visible
+			glm::vec3 viewCenter = glm::vec3(view * world * glm::vec4(Center, 1.0f));
+			float distance = glm::length(viewCenter) - Radius * scale;
+			if (distance <= 0.0f)
+				return 0;
+			pixelsPerUnit /= distance;
+		}
+
+		// Levels get simpler and less accurate as we go, so take the last one that still looks right
+		size_t result = 0;
+		for (size_t ix = 1; ix < Levels.size(); ix++) {
+			if (Levels[ix].Mesh == nullptr || Levels[ix].Error * pixelsPerUnit > MaxScreenError)
+				break;
+			result = ix;
+		}
+		return result;
+	}
+};
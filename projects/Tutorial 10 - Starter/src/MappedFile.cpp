@@ -0,0 +1,77 @@
+#include "MappedFile.h"
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* filename) :
+	myData(nullptr),
+	mySize(0),
+	myFileHandle(nullptr),
+	myMappingHandle(nullptr)
+{
+#ifdef WINDOWS
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	myFileHandle = file;
+
+	LARGE_INTEGER size;
+	// We can't map an empty file, so we treat it as a failure
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return;
+	mySize = static_cast<size_t>(size.QuadPart);
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+		return;
+	myMappingHandle = mapping;
+
+	myData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return;
+	// We store the descriptor offset by one, so that a null handle means no file
+	myFileHandle = reinterpret_cast<void*>(static_cast<intptr_t>(file) + 1);
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+		return;
+	mySize = static_cast<size_t>(info.st_size);
+
+	void* data = mmap(nullptr, mySize, PROT_READ, MAP_PRIVATE, file, 0);
+	myData = data != MAP_FAILED ? static_cast<const uint8_t*>(data) : nullptr;
+#endif
+
+	if (myData == nullptr)
+		mySize = 0;
+}
+
+MappedFile::~MappedFile() {
+#ifdef WINDOWS
+	if (myData != nullptr)
+		UnmapViewOfFile(myData);
+	if (myMappingHandle != nullptr)
+		CloseHandle(myMappingHandle);
+	if (myFileHandle != nullptr)
+		CloseHandle(myFileHandle);
+#else
+	if (myData != nullptr)
+		munmap(const_cast<uint8_t*>(myData), mySize);
+	if (myFileHandle != nullptr)
+		close(static_cast<int>(reinterpret_cast<intptr_t>(myFileHandle) - 1));
+#endif
+}
+
+MappedFile::Sptr MappedFile::Open(const char* filename) {
+	Sptr result = std::make_shared<MappedFile>(filename);
+	return result->IsValid() ? result : nullptr;
+}
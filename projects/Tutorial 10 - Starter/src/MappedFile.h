@@ -0,0 +1,43 @@
+/*
+	A read-only view of a file that has been memory mapped into our address space
+*/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "Utils.h"
+
+class MappedFile {
+public:
+	typedef std::shared_ptr<MappedFile> Sptr;
+	NoCopy(MappedFile);
+	NoMove(MappedFile);
+
+	/*
+	 * Maps the given file into memory, use IsValid to check if the mapping succeeded
+	 * @param filename The path of the file to map
+	 */
+	MappedFile(const char* filename);
+	~MappedFile();
+
+	// Returns true if the file was opened and mapped successfully
+	bool IsValid() const { return myData != nullptr; }
+
+	// Gets the contents of the file (nullptr if the mapping failed)
+	const uint8_t* GetData() const { return myData; }
+	// Gets the size of the file in bytes
+	size_t GetSize() const { return mySize; }
+
+	/*
+	 * Maps the given file, returning nullptr if it could not be mapped
+	 */
+	static Sptr Open(const char* filename);
+
+private:
+	const uint8_t* myData;
+	size_t         mySize;
+
+	// Platform handles for the file and the mapping
+	void*          myFileHandle;
+	void*          myMappingHandle;
+};
@@ -2,15 +2,15 @@
 
 void Material::Apply() {
 	for (auto& kvp : myMat4s)
-		myShader->SetUniform(kvp.first.c_str(), kvp.second);
+		myShader->SetUniform(kvp.first, kvp.second);
 	for (auto& kvp : myVec4s)
-		myShader->SetUniform(kvp.first.c_str(), kvp.second);
+		myShader->SetUniform(kvp.first, kvp.second);
 	for (auto& kvp : myVec3s)
-		myShader->SetUniform(kvp.first.c_str(), kvp.second);
+		myShader->SetUniform(kvp.first, kvp.second);
 	for (auto& kvp : myFloats)
-		myShader->SetUniform(kvp.first.c_str(), kvp.second);
+		myShader->SetUniform(kvp.first, kvp.second);
 	for (auto& kvp : myInts)
-		myShader->SetUniform(kvp.first.c_str(), kvp.second);
+		myShader->SetUniform(kvp.first, kvp.second);
 	
 
 	// New in tutorial 06
@@ -22,7 +22,7 @@ void Material::Apply() {
 		else
 			TextureSampler::Unbind(slot);
 		kvp.second.Texture->Bind(slot);
-		myShader->SetUniform(kvp.first.c_str(), slot);
+		myShader->SetUniform(kvp.first, slot);
 		slot++;
 
 
@@ -34,7 +34,7 @@ void Material::Apply() {
 		else
 			TextureSampler::Unbind(slot);
 		kvp.second.Texture->Bind(slot);
-		myShader->SetUniform(kvp.first.c_str(), slot);
+		myShader->SetUniform(kvp.first, slot);
 		slot++;
 	}
 
@@ -22,20 +22,21 @@ public:
 	const Shader::Sptr& GetShader() const { return myShader; }
 	virtual void Apply();
 	
-	void Set(const std::string& name, const glm::mat4& value) { myMat4s[name] = value; }
-	void Set(const std::string& name, const glm::vec4& value) { myVec4s[name] = value; }
-	void Set(const std::string& name, const glm::vec3& value) { myVec3s[name] = value; }
-	void Set(const std::string& name, const float& value) { myFloats[name] = value; }
+	// Our values are keyed by uniform ID, so that Apply never has to look up a name
+	void Set(const std::string& name, const glm::mat4& value) { myMat4s[Shader::GetUniformId(name)] = value; }
+	void Set(const std::string& name, const glm::vec4& value) { myVec4s[Shader::GetUniformId(name)] = value; }
+	void Set(const std::string& name, const glm::vec3& value) { myVec3s[Shader::GetUniformId(name)] = value; }
+	void Set(const std::string& name, const float& value) { myFloats[Shader::GetUniformId(name)] = value; }
 	void Set(const std::string& name, const TextureCube::Sptr& value, const TextureSampler::Sptr& sampler = nullptr) {
-		myCubeMaps[name] = { value, sampler };
+		myCubeMaps[Shader::GetUniformId(name)] = { value, sampler };
 	}
-	void Set(const std::string & name, const int& value) { myInts[name] = value; }
+	void Set(const std::string & name, const int& value) { myInts[Shader::GetUniformId(name)] = value; }
 
 
 	// New in tutorial 06
 	void Set(const std::string& name, const Texture2D::Sptr& value,
 		const TextureSampler::Sptr& sampler = nullptr) {
-		myTextures[name] = { value, sampler };
+		myTextures[Shader::GetUniformId(name)] = { value, sampler };
 	}
 	
 protected:
@@ -45,20 +46,20 @@ protected:
 	};
 	
 	Shader::Sptr myShader;
-	std::unordered_map<std::string, glm::mat4> myMat4s;
-	std::unordered_map<std::string, glm::vec4> myVec4s;
-	std::unordered_map<std::string, glm::vec3> myVec3s;
-	std::unordered_map<std::string, glm::vec2> myVec2s;
-	std::unordered_map<std::string, float> myFloats;
-	std::unordered_map<std::string, int> myInts;
+	std::unordered_map<Shader::UniformId, glm::mat4> myMat4s;
+	std::unordered_map<Shader::UniformId, glm::vec4> myVec4s;
+	std::unordered_map<Shader::UniformId, glm::vec3> myVec3s;
+	std::unordered_map<Shader::UniformId, glm::vec2> myVec2s;
+	std::unordered_map<Shader::UniformId, float> myFloats;
+	std::unordered_map<Shader::UniformId, int> myInts;
 
 	// New in tutorial 06
-	std::unordered_map<std::string, Sampler2DInfo> myTextures;
+	std::unordered_map<Shader::UniformId, Sampler2DInfo> myTextures;
 
 	struct SamplerCubeInfo {
 		TextureCube::Sptr Texture;
 		TextureSampler::Sptr Sampler;
 	};
-	std::unordered_map<std::string, SamplerCubeInfo> myCubeMaps;
+	std::unordered_map<Shader::UniformId, SamplerCubeInfo> myCubeMaps;
 
 };
\ No newline at end of file
@@ -1,68 +1,117 @@
 #include "Mesh.h"
 
-Mesh::Mesh(Vertex* vertices, size_t numVerts, uint32_t* indices, size_t numIndices) {
-	myIndexCount = numIndices;
-	myVertexCount = numVerts;
-
+#include <GLM/gtc/packing.hpp>
 
-	// Create and bind our vertex array
-	glCreateVertexArrays(1, &myVao);
-	glBindVertexArray(myVao);
+PackedVertex PackedVertex::Pack(const Vertex& vertex) {
+	PackedVertex result;
+	result.Position[0] = glm::packHalf1x16(vertex.Position.x);
+	result.Position[1] = glm::packHalf1x16(vertex.Position.y);
+	result.Position[2] = glm::packHalf1x16(vertex.Position.z);
+	result.Padding     = 0;
+	result.Color       = glm::packUnorm4x8(vertex.Color);
+	// The 2 bit W component is unused, we just leave it at 0
+	result.Normal      = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+	result.UV[0]       = glm::packHalf1x16(vertex.UV.x);
+	result.UV[1]       = glm::packHalf1x16(vertex.UV.y);
+	// The 2 bit W holds -1, 0 or 1 exactly, which is all we need for the bitangent sign
+	result.Tangent     = glm::packSnorm3x10_1x2(vertex.Tangent);
+	return result;
+}
 
-	// Create 2 buffers, 1 for vertices and the other for indices
-	glCreateBuffers(2, myBuffers);
+std::vector<PackedVertex> PackedVertex::Pack(const std::vector<Vertex>& vertices) {
+	std::vector<PackedVertex> result(vertices.size());
+	for (size_t ix = 0; ix < vertices.size(); ix++)
+		result[ix] = Pack(vertices[ix]);
+	return result;
+}
 
-	// Bind and buffer our vertex data
-	glBindBuffer(GL_ARRAY_BUFFER, myBuffers[0]);
-	glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+void Mesh::__CreateBuffers(const GeometryArena::Sptr& arena, const void* vertices, size_t numVerts, const uint32_t* indices, size_t numIndices) {
+	myIndexCount = numIndices;
+	myVertexCount = numVerts;
+	myArena = arena;
 
-	// Bind and buffer our index data
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, myBuffers[1]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+	// Narrow to 16 bit indices if all of our vertices can be addressed with them. Each draw says which index type
+	// it uses, so meshes with either type can share the arena's index buffers
+	myIndexType = GetIndexTypeFor(numVerts);
+	size_t indexSize = myIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	if (myIndexType == GL_UNSIGNED_SHORT) {
+		std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+		myAllocation = myArena->Allocate(vertices, numVerts, shortIndices.data(), numIndices * indexSize);
+	} else {
+		myAllocation = myArena->Allocate(vertices, numVerts, indices, numIndices * indexSize);
+	}
 
-	// Get a null vertex to get member offsets from
-	Vertex* vert = nullptr;
-	
-	// Enable vertex attribute 0
-	glEnableVertexAttribArray(0);
-	// Our first attribute is 3 floats, the distance between 
-	// them is the size of our vertex, and they will map to the position in our vertices
-	glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), &(vert->Position)); 
+	mySizeBytes = numVerts * myArena->GetStride() + numIndices * indexSize;
 
-	// Enable vertex attribute 1
-	glEnableVertexAttribArray(1);
-	// Our second attribute is 4 floats, the distance between 
-	// them is the size of our vertex, and they will map to the color in our vertices
-	glVertexAttribPointer(1, 4, GL_FLOAT, false, sizeof(Vertex), &(vert->Color));
+	if (numIndices > 0) {
+		_IndexStats.IndexedMeshes++;
+		_IndexStats.IndexBytes += numIndices * indexSize;
+		if (myIndexType == GL_UNSIGNED_SHORT) {
+			_IndexStats.ShortIndexMeshes++;
+			_IndexStats.BytesSaved += numIndices * (sizeof(uint32_t) - sizeof(uint16_t));
+		}
+	}
+}
 
+MeshIndexStats Mesh::_IndexStats;
 
-	// Enable vertex attribute 2
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(Vertex), &(vert->Normal));
+Mesh::~Mesh() {
+	// Remove ourselves from the index statistics
+	if (myIndexCount > 0) {
+		_IndexStats.IndexedMeshes--;
+		_IndexStats.IndexBytes -= myIndexCount * (myIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+		if (myIndexType == GL_UNSIGNED_SHORT) {
+			_IndexStats.ShortIndexMeshes--;
+			_IndexStats.BytesSaved -= myIndexCount * (sizeof(uint32_t) - sizeof(uint16_t));
+		}
+	}
+	// Give our space in the arena back to other meshes
+	myArena->Free(myAllocation);
+}
 
-	// New in tutorial 06
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(Vertex), &(vert->UV));
-	
-	// Unbind our VAO
-	glBindVertexArray(0);
+void Mesh::Draw() {
+	// Bind the arena page that holds our data, this is skipped if the last mesh drawn was in the same page
+	myArena->Bind(myAllocation.Page);
+	GeometryArena::CountDraw();
+	if (myIndexCount > 0) {
+		// Our indices start from 0, the base vertex moves them to where our vertices are in the page
+		glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(myIndexCount), myIndexType,
+			reinterpret_cast<const void*>(myAllocation.IndexOffset), myAllocation.BaseVertex);
+	} else {
+		// Draw all of our vertices as triangles
+		glDrawArrays(GL_TRIANGLES, myAllocation.BaseVertex, static_cast<GLsizei>(myVertexCount));
+	}
 }
 
-Mesh::~Mesh() {
-	// Clean up our buffers
-	glDeleteBuffers(2, myBuffers);
-	// Clean up our VAO
-	glDeleteVertexArrays(1, &myVao);
+void Mesh::DrawRanges(const std::vector<MeshletRange>& ranges) {
+	if (ranges.empty())
+		return;
+	myArena->Bind(myAllocation.Page);
+	GeometryArena::CountDraw();
+	// We only ever draw on the main thread, so these can be reused between calls
+	static std::vector<GLsizei>     counts;
+	static std::vector<const void*> offsets;
+	static std::vector<GLint>       baseVertices;
+	counts.resize(ranges.size());
+	offsets.resize(ranges.size());
+	baseVertices.assign(ranges.size(), myAllocation.BaseVertex);
+	size_t indexSize = myIndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	for (size_t ix = 0; ix < ranges.size(); ix++) {
+		counts[ix]  = static_cast<GLsizei>(ranges[ix].IndexCount);
+		offsets[ix] = reinterpret_cast<const void*>(myAllocation.IndexOffset + ranges[ix].IndexOffset * indexSize);
+	}
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), myIndexType, offsets.data(), static_cast<GLsizei>(ranges.size()), baseVertices.data());
 }
 
-void Mesh::Draw() {
-	// Bind the mesh
-	glBindVertexArray(myVao);
+void Mesh::DrawInstanced(size_t instanceCount) {
+	if (instanceCount == 0)
+		return;
+	myArena->Bind(myAllocation.Page);
+	GeometryArena::CountDraw();
 	if (myIndexCount > 0) {
-		// Draw all of our vertices as triangles, our indexes are unsigned ints (uint32_t)
-		glDrawElements(GL_TRIANGLES, myIndexCount, GL_UNSIGNED_INT, nullptr);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(myIndexCount), myIndexType,
+			reinterpret_cast<const void*>(myAllocation.IndexOffset), static_cast<GLsizei>(instanceCount), myAllocation.BaseVertex);
 	} else {
-		// Draw all of our vertices as triangles, our indexes are unsigned ints (uint32_t)
-		glDrawArrays(GL_TRIANGLES, 0, myVertexCount);
+		glDrawArraysInstanced(GL_TRIANGLES, myAllocation.BaseVertex, static_cast<GLsizei>(myVertexCount), static_cast<GLsizei>(instanceCount));
 	}
 }
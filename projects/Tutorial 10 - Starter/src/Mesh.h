@@ -4,7 +4,11 @@
 #include <GLM/glm.hpp> // For vec3 and vec4
 #include <cstdint> // Needed for uint32_t
 #include <memory> // Needed for smart pointers
+#include <vector>
 #include "Utils.h"
+#include "VertexLayout.h"
+#include "Meshlet.h"
+#include "GeometryArena.h"
 
 struct Vertex {
 	glm::vec3 Position;
@@ -13,24 +17,157 @@ struct Vertex {
 
 	// New in tutorial 06
 	glm::vec2 UV;
+
+	// The direction that U increases in along the surface, with the handedness of the bitangent in W
+	// (bitangent = cross(Normal, Tangent.xyz) * Tangent.w), see TangentGenerator
+	glm::vec4 Tangent = glm::vec4(0.0f);
+};
+
+/*
+ * A compact alternative to Vertex (24 bytes instead of 64), with half float positions and UVs, an 8 bit per
+ * channel color and a 10 bit per component normal and tangent. OpenGL unpacks these for us, so shaders see the same inputs
+ */
+struct PackedVertex {
+	uint16_t Position[3]; // Half floats
+	uint16_t Padding;     // Keeps the rest of the attributes 4 byte aligned
+	uint32_t Color;       // RGBA, 8 bits per channel normalized
+	uint32_t Normal;      // XYZ, 10 bits per component signed normalized
+	uint16_t UV[2];       // Half floats
+	uint32_t Tangent;     // XYZ, 10 bits per component signed normalized, with the bitangent sign in the 2 bit W
+
+	/*
+	 * Converts a full precision vertex into a packed vertex
+	 */
+	static PackedVertex Pack(const Vertex& vertex);
+	/*
+	 * Converts a list of full precision vertices into packed vertices
+	 */
+	static std::vector<PackedVertex> Pack(const std::vector<Vertex>& vertices);
+};
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex should be 24 bytes");
+
+/*
+ * A vertex with only a position, for meshes like our skybox where the shader doesn't need anything else
+ */
+struct PositionVertex {
+	glm::vec3 Position;
+};
+
+// The attribute locations here match the inputs our shaders use (0 = position, 1 = color, 2 = normal, 3 = UV, 4 = tangent)
+VERTEX_LAYOUT(Vertex,
+	VertexAttribute<&Vertex::Position, 0>,
+	VertexAttribute<&Vertex::Color,    1>,
+	VertexAttribute<&Vertex::Normal,   2>,
+	VertexAttribute<&Vertex::UV,       3>,
+	VertexAttribute<&Vertex::Tangent,  4>
+);
+// Packed attributes get unpacked to floats by OpenGL, the normal and tangent are 4 components since that's what 2_10_10_10 requires
+VERTEX_LAYOUT(PackedVertex,
+	VertexAttribute<&PackedVertex::Position, 0, GL_HALF_FLOAT>,
+	VertexAttribute<&PackedVertex::Color,    1, GL_UNSIGNED_BYTE, 4, true>,
+	VertexAttribute<&PackedVertex::Normal,   2, GL_INT_2_10_10_10_REV, 4, true>,
+	VertexAttribute<&PackedVertex::UV,       3, GL_HALF_FLOAT>,
+	VertexAttribute<&PackedVertex::Tangent,  4, GL_INT_2_10_10_10_REV, 4, true>
+);
+VERTEX_LAYOUT(PositionVertex,
+	VertexAttribute<&PositionVertex::Position, 0>
+);
+
+/*
+ * Gets the smallest index type that can address the given number of vertices, GL_UNSIGNED_SHORT if there
+ * are 65536 or fewer, otherwise GL_UNSIGNED_INT
+ */
+inline GLenum GetIndexTypeFor(size_t vertexCount) {
+	return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+/*
+ * Helper structure to store the data required to create a mesh
+ */
+struct MeshData {
+	/*
+	 * The vertex data for the mesh
+	 */
+	std::vector<Vertex>   Vertices;
+	/*
+	 * The index data for the mesh, these are always stored as 32 bit, Mesh will narrow them when uploading
+	 */
+	std::vector<uint32_t> Indices;
+
+	/*
+	 * Gets the index type that a mesh made from this data will use on the GPU
+	 */
+	GLenum GetIndexType() const { return GetIndexTypeFor(Vertices.size()); }
+};
+
+/*
+ * Statistics for the index buffers of all of the meshes that are currently alive
+ */
+struct MeshIndexStats {
+	// The number of meshes that have index buffers
+	size_t IndexedMeshes = 0;
+	// The number of those meshes that use 16 bit indices
+	size_t ShortIndexMeshes = 0;
+	// The number of bytes used by index buffers on the GPU
+	size_t IndexBytes = 0;
+	// The number of bytes saved by using 16 bit indices instead of 32 bit
+	size_t BytesSaved = 0;
 };
 
 class Mesh {
 public:
 	GraphicsClass(Mesh);
 	
-	// Creates a new mesh from the given vertices and indices
-	Mesh(Vertex* vertices, size_t numVerts, uint32_t* indices, size_t numIndices);
+	/*
+	 * Creates a new mesh from the given vertices and indices. The data is stored in the GeometryArena shared by
+	 * every mesh with the same vertex type, which sets up its attributes from the VERTEX_LAYOUT for the type
+	 */
+	template <typename TVertex>
+	Mesh(const TVertex* vertices, size_t numVerts, const uint32_t* indices, size_t numIndices) {
+		__CreateBuffers(GeometryArena::GetShared<TVertex>(), vertices, numVerts, indices, numIndices);
+	}
 	~Mesh();
 
 	// Draws this mesh
 	void Draw();
+	// Draws only the given ranges of this mesh's index buffer, see MeshletCuller
+	void DrawRanges(const std::vector<MeshletRange>& ranges);
+	// Draws this mesh the given number of times, shaders can tell the copies apart with gl_InstanceID
+	void DrawInstanced(size_t instanceCount);
+
+	// Sets the meshlets that this mesh's index buffer is split into, see MeshOptimizer::BuildMeshlets
+	void SetMeshlets(const std::vector<Meshlet>& meshlets) { myMeshlets = meshlets; }
+	// Gets this mesh's meshlets, which will be empty if it has not been split up
+	const std::vector<Meshlet>& GetMeshlets() const { return myMeshlets; }
+
+	// Gets the type of this mesh's indices (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+	GLenum GetIndexType() const { return myIndexType; }
+	// Gets the number of indices this mesh draws
+	size_t GetIndexCount() const { return myIndexCount; }
+	// Gets the number of bytes used by this mesh's vertex and index buffers
+	size_t GetSizeBytes() const { return mySizeBytes; }
+	// Gets the arena that holds this mesh's data, and where in it the data is, for batched drawing
+	const GeometryArena::Sptr&       GetArena() const { return myArena; }
+	const GeometryArena::Allocation& GetAllocation() const { return myAllocation; }
+
+	// Gets the index buffer statistics for all meshes that are currently alive
+	static const MeshIndexStats& GetIndexStats() { return _IndexStats; }
 
 private:
-	// Our GL handle for the Vertex Array Object
-	GLuint myVao;
-	// 0 is vertices, 1 is indices
-	GLuint myBuffers[2];
+	// Copies our vertices and indices into the arena
+	void __CreateBuffers(const GeometryArena::Sptr& arena, const void* vertices, size_t numVerts, const uint32_t* indices, size_t numIndices);
+
+	// The arena that holds our data, and where in it our data is
+	GeometryArena::Sptr       myArena;
+	GeometryArena::Allocation myAllocation;
 	// The number of vertices and indices in this mesh
 	size_t myVertexCount, myIndexCount;
+	// The type of our indices, we use 16 bit indices whenever we have few enough vertices
+	GLenum myIndexType;
+	// The combined size of our buffers, in bytes
+	size_t mySizeBytes;
+	// The clusters that our index buffer is made of, used for culling
+	std::vector<Meshlet> myMeshlets;
+
+	static MeshIndexStats _IndexStats;
 };
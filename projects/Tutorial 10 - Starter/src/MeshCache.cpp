@@ -0,0 +1,224 @@
+#include "MeshCache.h"
+#include "FileStream.h"
+#include "Logging.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// The header at the start of every .smesh file. It's followed by a MeshCacheLod for each LOD level, then the
+// vertices of the mesh and each of its levels, then the indices of the mesh and each of its levels
+struct MeshCacheHeader {
+	char      Magic[4];        // Always "SMSH"
+	uint32_t  Version;         // Must match MeshCache::Version
+	uint32_t  VertexStride;    // Must match sizeof(Vertex)
+	uint32_t  Flags;           // How the mesh was processed after loading (see MeshCache::FlagOptimized and FlagTangents)
+	uint64_t  SourceTimestamp; // The last write time of the source file when the cache was made
+	uint64_t  SourceHash;      // The hash of the source file's contents
+	uint64_t  VertexCount;
+	uint64_t  IndexCount;
+	glm::vec4 BaseColor;       // The base color the mesh was loaded with
+	uint64_t  LodKey;          // The settings the LOD levels were built with (see MeshCache::HashLodOptions), 0 for none
+	uint32_t  LodCount;        // The number of LOD levels stored after the full detail mesh
+	uint32_t  Reserved;
+};
+// Describes one LOD level stored in a cache
+struct MeshCacheLod {
+	uint64_t  VertexCount;
+	uint64_t  IndexCount;
+	float     Error;
+	uint32_t  Reserved[3];
+};
+// Keep the header and LOD table a multiple of 16 bytes, so our vertex data starts nicely aligned in the mapping
+static_assert(sizeof(MeshCacheHeader) == 80, "Mesh cache header must be 80 bytes");
+static_assert(sizeof(MeshCacheLod) == 32, "Mesh cache LOD entries must be 32 bytes");
+
+static const char MeshCacheMagic[4] = { 'S', 'M', 'S', 'H' };
+
+// Gets the last write time of a file, or 0 if the file does not exist
+static uint64_t GetTimestamp(const char* filename) {
+	std::error_code error;
+	auto time = std::filesystem::last_write_time(filename, error);
+	return error ? 0 : static_cast<uint64_t>(time.time_since_epoch().count());
+}
+
+std::string MeshCache::GetCachePath(const char* sourceFile) {
+	return std::string(sourceFile) + ".smesh";
+}
+
+uint64_t MeshCache::HashBytes(const void* data, size_t size, uint64_t hash) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t ix = 0; ix < size; ix++) {
+		hash ^= bytes[ix];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool MeshCache::HashFile(const char* filename, uint64_t& result) {
+	// The hash is of the decompressed contents, so that it matches what the loaders hashed
+	FileStream source(filename);
+	if (!source.IsOpen())
+		return false;
+	// Source files can be huge, so we hash them a piece at a time instead of reading them in all at once
+	std::vector<char> contents(1024 * 1024);
+	uint64_t hash = HashSeed;
+	while (!source.IsEnd()) {
+		size_t read = source.Read(contents.data(), contents.size());
+		hash = HashBytes(contents.data(), read, hash);
+	}
+	if (source.HasError())
+		return false;
+	result = hash;
+	return true;
+}
+
+uint64_t MeshCache::HashLodOptions(const LodChainOptions& options, uint64_t hash) {
+	// We hash each field on its own, so that padding in the struct can't change the key
+	uint64_t levelCount = options.LevelCount;
+	uint8_t  optimize   = options.Optimize ? 1 : 0;
+	hash = HashBytes(&levelCount, sizeof(levelCount), hash);
+	hash = HashBytes(&options.Ratio, sizeof(options.Ratio), hash);
+	hash = HashBytes(&options.MaxError, sizeof(options.MaxError), hash);
+	hash = HashBytes(&optimize, sizeof(optimize), hash);
+	// 0 means that a cache has no LODs, so we make sure that a real key can never be 0
+	return hash != 0 ? hash : 1;
+}
+
+bool MeshCache::TryLoad(const char* sourceFile, const glm::vec4& baseColor, uint32_t flags, uint64_t lodKey, MappedMeshData& result) {
+	std::string cachePath = GetCachePath(sourceFile);
+
+	// Start by reading just the header, so we can validate it before mapping anything
+	MeshCacheHeader header;
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(MeshCacheHeader)))
+			return false;
+	}
+
+	if (memcmp(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0 ||
+		header.Version != Version ||
+		header.VertexStride != sizeof(Vertex) ||
+		header.Flags != flags ||
+		header.BaseColor != baseColor ||
+		header.LodKey != lodKey) {
+		LOG_TRACE("Mesh cache '{}' is out of date", cachePath);
+		return false;
+	}
+
+	// If the source has been touched since the cache was made, we check if the contents actually changed
+	uint64_t timestamp = GetTimestamp(sourceFile);
+	if (timestamp != header.SourceTimestamp) {
+		uint64_t hash = 0;
+		if (!HashFile(sourceFile, hash))
+			return false;
+
+		if (hash != header.SourceHash) {
+			LOG_TRACE("Mesh cache '{}' does not match source, rebuilding", cachePath);
+			return false;
+		}
+
+		// Same contents, so we just update the timestamp to avoid hashing again on the next load
+		header.SourceTimestamp = timestamp;
+		std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		if (file)
+			file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+	}
+
+	// Map the cache, and make sure it's big enough to hold everything the header and LOD table claim it does
+	MappedFile::Sptr mapping = MappedFile::Open(cachePath.c_str());
+	size_t tableSize = sizeof(MeshCacheHeader) + header.LodCount * sizeof(MeshCacheLod);
+	if (mapping == nullptr || mapping->GetSize() < tableSize) {
+		LOG_WARN("Mesh cache '{}' is corrupt, rebuilding", cachePath);
+		return false;
+	}
+	const MeshCacheLod* lods = reinterpret_cast<const MeshCacheLod*>(mapping->GetData() + sizeof(MeshCacheHeader));
+	uint64_t vertexCount = header.VertexCount, indexCount = header.IndexCount;
+	for (uint32_t ix = 0; ix < header.LodCount; ix++) {
+		vertexCount += lods[ix].VertexCount;
+		indexCount  += lods[ix].IndexCount;
+	}
+	if (mapping->GetSize() != tableSize + vertexCount * sizeof(Vertex) + indexCount * sizeof(uint32_t)) {
+		LOG_WARN("Mesh cache '{}' is corrupt, rebuilding", cachePath);
+		return false;
+	}
+
+	const Vertex*   vertices = reinterpret_cast<const Vertex*>(mapping->GetData() + tableSize);
+	const uint32_t* indices  = reinterpret_cast<const uint32_t*>(vertices + vertexCount);
+	result.File        = mapping;
+	result.Vertices    = vertices;
+	result.VertexCount = static_cast<size_t>(header.VertexCount);
+	result.Indices     = indices;
+	result.IndexCount  = static_cast<size_t>(header.IndexCount);
+	result.Lods.clear();
+	vertices += header.VertexCount;
+	indices  += header.IndexCount;
+	for (uint32_t ix = 0; ix < header.LodCount; ix++) {
+		MappedLodLevel level;
+		level.Vertices    = vertices;
+		level.VertexCount = static_cast<size_t>(lods[ix].VertexCount);
+		level.Indices     = indices;
+		level.IndexCount  = static_cast<size_t>(lods[ix].IndexCount);
+		level.Error       = lods[ix].Error;
+		result.Lods.push_back(level);
+		vertices += lods[ix].VertexCount;
+		indices  += lods[ix].IndexCount;
+	}
+	return true;
+}
+
+bool MeshCache::Write(const char* sourceFile, uint64_t sourceHash, const glm::vec4& baseColor, uint32_t flags, uint64_t lodKey,
+	const MeshData& data, const std::vector<MeshLodLevel>& lods)
+{
+	std::string cachePath = GetCachePath(sourceFile);
+	// We write to a temporary file first, so that a failed write never leaves a broken cache behind
+	std::string tempPath  = cachePath + ".tmp";
+
+	MeshCacheHeader header;
+	memcpy(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+	header.Version         = Version;
+	header.VertexStride    = sizeof(Vertex);
+	header.Flags           = flags;
+	header.SourceTimestamp = GetTimestamp(sourceFile);
+	header.SourceHash      = sourceHash;
+	header.VertexCount     = data.Vertices.size();
+	header.IndexCount      = data.Indices.size();
+	header.BaseColor       = baseColor;
+	header.LodKey          = lodKey;
+	header.LodCount        = static_cast<uint32_t>(lods.size());
+	header.Reserved        = 0;
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(MeshCacheHeader));
+		for (const MeshLodLevel& level : lods) {
+			MeshCacheLod entry = {};
+			entry.VertexCount = level.Data.Vertices.size();
+			entry.IndexCount  = level.Data.Indices.size();
+			entry.Error       = level.Error;
+			file.write(reinterpret_cast<const char*>(&entry), sizeof(MeshCacheLod));
+		}
+		file.write(reinterpret_cast<const char*>(data.Vertices.data()), data.Vertices.size() * sizeof(Vertex));
+		for (const MeshLodLevel& level : lods)
+			file.write(reinterpret_cast<const char*>(level.Data.Vertices.data()), level.Data.Vertices.size() * sizeof(Vertex));
+		file.write(reinterpret_cast<const char*>(data.Indices.data()), data.Indices.size() * sizeof(uint32_t));
+		for (const MeshLodLevel& level : lods)
+			file.write(reinterpret_cast<const char*>(level.Data.Indices.data()), level.Data.Indices.size() * sizeof(uint32_t));
+		if (!file) {
+			LOG_WARN("Failed to write mesh cache '{}'", cachePath);
+			file.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error) {
+		LOG_WARN("Failed to write mesh cache '{}': {}", cachePath, error.message());
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
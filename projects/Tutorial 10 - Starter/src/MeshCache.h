@@ -0,0 +1,113 @@
+/*
+	Handles reading and writing our binary mesh cache files (.smesh), which store the final vertex and index
+	data for a mesh so that we don't need to re-parse the source file on every launch. A cache can also hold
+	the simpler levels of the mesh's LOD chain, so that we don't need to re-run the simplifier either
+*/
+#pragma once
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include <string>
+
+/*
+ * A view of one LOD level stored in a cache file, see MeshLodLevel
+ */
+struct MappedLodLevel {
+	const Vertex*    Vertices    = nullptr;
+	size_t           VertexCount = 0;
+	const uint32_t*  Indices     = nullptr;
+	size_t           IndexCount  = 0;
+	float            Error       = 0.0f;
+};
+
+/*
+ * A view of the mesh data stored in a cache file, the pointers are only valid while File is alive
+ */
+struct MappedMeshData {
+	MappedFile::Sptr File;
+	const Vertex*    Vertices    = nullptr;
+	size_t           VertexCount = 0;
+	const uint32_t*  Indices     = nullptr;
+	size_t           IndexCount  = 0;
+	// The simpler levels of the mesh's LOD chain (level 1 onwards), empty if the cache was written without them
+	std::vector<MappedLodLevel> Lods;
+};
+
+class MeshCache {
+public:
+	/*
+	 * The version of the cache format, this should be bumped whenever the layout of the file, the Vertex
+	 * structure or the output of the loaders change, so that old caches get rebuilt
+	 */
+	static const uint32_t Version = 4;
+	/*
+	 * Set in a cache's flags if the mesh was run through MeshOptimizer before it was stored
+	 */
+	static const uint32_t FlagOptimized = 1 << 0;
+	/*
+	 * Set in a cache's flags if the mesh's tangents were generated before it was stored
+	 */
+	static const uint32_t FlagTangents  = 1 << 1;
+
+	/*
+	 * Gets the path of the cache file for a source file (the source path with .smesh appended)
+	 */
+	static std::string GetCachePath(const char* sourceFile);
+
+	/*
+	 * Attempts to memory map the cache for the given source file. The cache is only used if it was made
+	 * from the same source (by timestamp, or by content hash if the timestamp has changed) with the same base color,
+	 * flags and LOD key
+	 * @param sourceFile The path of the file that the mesh was loaded from
+	 * @param baseColor  The vertex color that the mesh was loaded with
+	 * @param flags      How the mesh was processed after loading (see FlagOptimized and FlagTangents)
+	 * @param lodKey     The settings that the LOD levels were built with (see HashLodOptions), or 0 for none
+	 * @param result     Will store the mapped mesh data if the cache was valid
+	 * @returns True if the cache was valid and result was filled in, false if the source needs to be loaded
+	 */
+	static bool TryLoad(const char* sourceFile, const glm::vec4& baseColor, uint32_t flags, uint64_t lodKey, MappedMeshData& result);
+
+	/*
+	 * Writes the cache for the given source file
+	 * @param sourceFile The path of the file that the mesh was loaded from
+	 * @param sourceHash The hash of the source file's contents (see HashBytes)
+	 * @param baseColor  The vertex color that the mesh was loaded with
+	 * @param flags      How the mesh was processed after loading (see FlagOptimized and FlagTangents)
+	 * @param lodKey     The settings that the LOD levels were built with (see HashLodOptions), or 0 for none
+	 * @param data       The mesh data to store
+	 * @param lods       The levels of the mesh's LOD chain after the full detail mesh (level 1 onwards)
+	 * @returns True if the cache was written
+	 */
+	static bool Write(const char* sourceFile, uint64_t sourceHash, const glm::vec4& baseColor, uint32_t flags, uint64_t lodKey,
+		const MeshData& data, const std::vector<MeshLodLevel>& lods = std::vector<MeshLodLevel>());
+
+	/*
+	 * The starting value for HashBytes
+	 */
+	static const uint64_t HashSeed = 14695981039346656037ull;
+
+	/*
+	 * Computes the content hash that we use to validate caches (64 bit FNV-1a)
+	 * @param data The bytes to hash
+	 * @param size The number of bytes to hash
+	 * @param hash The hash of the data before this, so that large files can be hashed a piece at a time
+	 */
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashSeed);
+
+	/*
+	 * Computes the content hash of a file, a piece at a time so that large files don't need to fit in memory.
+	 * Compressed files are hashed by their decompressed contents, to match what the loaders see
+	 * @param filename The path of the file to hash
+	 * @param result   Will store the hash of the file's contents
+	 * @returns True if the file could be read
+	 */
+	static bool HashFile(const char* filename, uint64_t& result);
+
+	/*
+	 * Computes the LOD key for a set of LOD chain settings, which a cache's levels must match to be loaded
+	 * @param options The settings for the LOD chain
+	 * @param hash    The hash of anything else the levels depend on, for meshes that aren't just a source file
+	 */
+	static uint64_t HashLodOptions(const LodChainOptions& options, uint64_t hash = HashSeed);
+};
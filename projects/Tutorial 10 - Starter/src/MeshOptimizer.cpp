@@ -0,0 +1,416 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+
+/*
+ * Simulates a FIFO cache with timestamps instead of an actual queue. A vertex is in the cache if fewer than
+ * cacheSize vertices have been added since it was, which is exactly how a FIFO of that size behaves
+ */
+struct FifoCacheSimulator {
+	std::vector<size_t> AddedAt;
+	size_t              Timestamp;
+	size_t              CacheSize;
+
+	FifoCacheSimulator(size_t vertexCount, size_t cacheSize) :
+		AddedAt(vertexCount, 0),
+		Timestamp(cacheSize + 1),
+		CacheSize(cacheSize) { }
+
+	// Empties the cache, without having to touch every vertex
+	void Flush() { Timestamp += CacheSize + 1; }
+
+	// Processes a vertex, returning true if it missed the cache
+	bool Access(uint32_t vertex) {
+		if (Timestamp - AddedAt[vertex] > CacheSize) {
+			AddedAt[vertex] = Timestamp++;
+			return true;
+		}
+		return false;
+	}
+};
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+	VertexCacheStats result;
+	if (indexCount == 0 || vertexCount == 0)
+		return result;
+
+	FifoCacheSimulator cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t usedCount = 0;
+	for (size_t ix = 0; ix < indexCount; ix++) {
+		uint32_t vertex = indices[ix];
+		if (cache.Access(vertex))
+			result.Misses++;
+		if (!used[vertex]) {
+			used[vertex] = true;
+			usedCount++;
+		}
+	}
+
+	result.ACMR = result.Misses / static_cast<float>(indexCount / 3);
+	result.ATVR = result.Misses / static_cast<float>(usedCount);
+	return result;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize, std::vector<uint32_t>* clusters) {
+	size_t triangleCount = indices.size() / 3;
+	if (clusters != nullptr) {
+		clusters->clear();
+		clusters->push_back(0);
+	}
+	if (triangleCount == 0)
+		return;
+
+	// Build our vertex to triangle adjacency, stored as one flat list with an offset per vertex
+	std::vector<uint32_t> liveCount(vertexCount, 0);
+	for (uint32_t vertex : indices)
+		liveCount[vertex]++;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++)
+		adjacencyOffsets[ix + 1] = adjacencyOffsets[ix] + liveCount[ix];
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t ix = 0; ix < indices.size(); ix++)
+			adjacency[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+	}
+
+	// The time that each vertex entered the cache, see FifoCacheSimulator
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	size_t timestamp = cacheSize + 1;
+	// The vertices we've touched, which are our fallback if we run out of good candidates
+	std::vector<uint32_t> deadEnds;
+	deadEnds.reserve(indices.size());
+	std::vector<uint32_t> candidates;
+	std::vector<bool> emitted(triangleCount, false);
+	// Where we will continue scanning for unfinished vertices when we run out of everything else
+	size_t cursor = 0;
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	int64_t fanVertex = indices[0];
+	while (fanVertex >= 0) {
+		// Emit every remaining triangle around our fanning vertex
+		candidates.clear();
+		for (uint32_t ix = adjacencyOffsets[fanVertex]; ix < adjacencyOffsets[fanVertex + 1]; ix++) {
+			uint32_t triangle = adjacency[ix];
+			if (emitted[triangle])
+				continue;
+			for (int jx = 0; jx < 3; jx++) {
+				uint32_t vertex = indices[triangle * 3 + jx];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveCount[vertex]--;
+				if (timestamp - cacheTime[vertex] > cacheSize)
+					cacheTime[vertex] = timestamp++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Pick the next vertex to fan around, preferring the oldest vertex that will still be in the cache
+		// once all of its triangles are emitted (each triangle adds at most 2 new vertices)
+		fanVertex = -1;
+		size_t bestPriority = 0;
+		for (uint32_t vertex : candidates) {
+			if (liveCount[vertex] > 0) {
+				size_t age = timestamp - cacheTime[vertex];
+				if (age + 2 * liveCount[vertex] <= cacheSize && age > bestPriority) {
+					bestPriority = age;
+					fanVertex = vertex;
+				}
+			}
+		}
+
+		// Otherwise we've hit a dead end, so try the vertices we've recently touched, then any vertex at all
+		if (fanVertex < 0) {
+			while (!deadEnds.empty() && fanVertex < 0) {
+				uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveCount[vertex] > 0)
+					fanVertex = vertex;
+			}
+			while (fanVertex < 0 && cursor < vertexCount) {
+				if (liveCount[cursor] > 0)
+					fanVertex = static_cast<int64_t>(cursor);
+				cursor++;
+			}
+			if (fanVertex >= 0 && clusters != nullptr)
+				clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(MeshData& data, const std::vector<uint32_t>& clusters, size_t cacheSize, float threshold) {
+	std::vector<uint32_t>& indices = data.Indices;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty())
+		return;
+
+	// Split our clusters further wherever starting over with an empty cache costs us little. We do this by
+	// growing each piece until its ACMR is within our threshold of the whole cluster's ACMR
+	std::vector<uint32_t> pieces;
+	FifoCacheSimulator cache(data.Vertices.size(), cacheSize);
+	for (size_t ix = 0; ix < clusters.size(); ix++) {
+		size_t start = clusters[ix];
+		size_t end   = ix + 1 < clusters.size() ? clusters[ix + 1] : triangleCount;
+
+		cache.Flush();
+		size_t clusterMisses = 0;
+		for (size_t tri = start; tri < end; tri++)
+			for (int jx = 0; jx < 3; jx++)
+				clusterMisses += cache.Access(indices[tri * 3 + jx]) ? 1 : 0;
+		float targetAcmr = threshold * clusterMisses / static_cast<float>(end - start);
+
+		cache.Flush();
+		size_t pieceStart = start, pieceMisses = 0;
+		pieces.push_back(static_cast<uint32_t>(start));
+		for (size_t tri = start; tri < end; tri++) {
+			for (int jx = 0; jx < 3; jx++)
+				pieceMisses += cache.Access(indices[tri * 3 + jx]) ? 1 : 0;
+			if (tri + 1 < end && pieceMisses <= targetAcmr * (tri + 1 - pieceStart)) {
+				pieceStart = tri + 1;
+				pieceMisses = 0;
+				pieces.push_back(static_cast<uint32_t>(pieceStart));
+				cache.Flush();
+			}
+		}
+	}
+
+	// Work out the area weighted center and normal of each piece, as well as the center of the whole mesh
+	struct Piece {
+		uint32_t  Start, End;
+		glm::vec3 Center;
+		glm::vec3 Normal;
+		float     Area;
+		float     SortKey;
+	};
+	std::vector<Piece> sorted(pieces.size());
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t ix = 0; ix < pieces.size(); ix++) {
+		Piece& piece = sorted[ix];
+		piece.Start  = pieces[ix];
+		piece.End    = ix + 1 < pieces.size() ? pieces[ix + 1] : static_cast<uint32_t>(triangleCount);
+		piece.Center = glm::vec3(0.0f);
+		piece.Normal = glm::vec3(0.0f);
+		piece.Area   = 0.0f;
+		for (uint32_t tri = piece.Start; tri < piece.End; tri++) {
+			const glm::vec3& a = data.Vertices[indices[tri * 3 + 0]].Position;
+			const glm::vec3& b = data.Vertices[indices[tri * 3 + 1]].Position;
+			const glm::vec3& c = data.Vertices[indices[tri * 3 + 2]].Position;
+			// The cross product's length is twice the area of the triangle, which is fine for weighting
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+			piece.Center += (a + b + c) * (area / 3.0f);
+			piece.Normal += normal;
+			piece.Area   += area;
+		}
+		meshCenter += piece.Center;
+		meshArea   += piece.Area;
+		if (piece.Area > 0.0f)
+			piece.Center /= piece.Area;
+	}
+	if (meshArea > 0.0f)
+		meshCenter /= meshArea;
+
+	// Pieces that are further out along their normal are more likely to be in front of the rest of the mesh
+	for (Piece& piece : sorted) {
+		float length = glm::length(piece.Normal);
+		piece.SortKey = length > 0.0f ? glm::dot(piece.Center - meshCenter, piece.Normal / length) : 0.0f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Piece& a, const Piece& b) { return a.SortKey > b.SortKey; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const Piece& piece : sorted)
+		result.insert(result.end(), indices.begin() + piece.Start * 3, indices.begin() + piece.End * 3);
+	indices = std::move(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& data) {
+	const uint32_t unused = static_cast<uint32_t>(-1);
+	std::vector<uint32_t> remap(data.Vertices.size(), unused);
+	std::vector<Vertex> vertices;
+	vertices.reserve(data.Vertices.size());
+
+	for (uint32_t& index : data.Indices) {
+		if (remap[index] == unused) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(data.Vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	data.Vertices = std::move(vertices);
+}
+
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(MeshData& data, const MeshletOptions& options, const std::vector<glm::vec3>* positions) {
+	std::vector<Meshlet> result;
+	size_t vertexCount   = data.Vertices.size();
+	size_t triangleCount = data.Indices.size() / 3;
+	if (triangleCount == 0)
+		return result;
+	auto positionOf = [&](uint32_t vertex) -> const glm::vec3& {
+		return positions != nullptr ? (*positions)[vertex] : data.Vertices[vertex].Position;
+	};
+
+	// Build our vertex to triangle adjacency, so that we can find the triangles around the edge of a meshlet
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t vertex : data.Indices)
+		adjacencyOffsets[vertex + 1]++;
+	for (size_t ix = 0; ix < vertexCount; ix++)
+		adjacencyOffsets[ix + 1] += adjacencyOffsets[ix];
+	std::vector<uint32_t> adjacency(data.Indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t ix = 0; ix < data.Indices.size(); ix++)
+			adjacency[fill[data.Indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+	}
+
+	// Degenerate triangles get a zero normal, so they don't pull the cones around
+	std::vector<glm::vec3> normals(triangleCount);
+	std::vector<glm::vec3> centroids(triangleCount);
+	double totalArea = 0.0;
+	for (size_t ix = 0; ix < triangleCount; ix++) {
+		const uint32_t* triangle = &data.Indices[ix * 3];
+		glm::vec3 p0 = positionOf(triangle[0]), p1 = positionOf(triangle[1]), p2 = positionOf(triangle[2]);
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		normals[ix]   = length > 0.0f ? normal / length : glm::vec3(0.0f);
+		centroids[ix] = (p0 + p1 + p2) / 3.0f;
+		totalArea += length * 0.5;
+	}
+	// Roughly how big a full, round meshlet would be, so that we can keep meshlets from growing into long strips
+	float meshletRadius = static_cast<float>(sqrt(totalArea / triangleCount * options.MaxTriangles / 3.14159265358979));
+	if (meshletRadius <= 0.0f)
+		meshletRadius = 1.0f;
+
+	std::vector<uint32_t> indices;
+	indices.reserve(data.Indices.size());
+	std::vector<bool>     emitted(triangleCount, false);
+	// The meshlet that each vertex was last added to, so we can tell which vertices a triangle would add
+	std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> meshletTriangles;
+	size_t nextSeed = 0;
+
+	while (indices.size() < data.Indices.size()) {
+		uint32_t  id = static_cast<uint32_t>(result.size());
+		size_t    meshletVertices = 0;
+		glm::vec3 normalSum(0.0f);
+		glm::vec3 centroidSum(0.0f);
+		candidates.clear();
+		meshletTriangles.clear();
+
+		while (meshletTriangles.size() < options.MaxTriangles) {
+			glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+			glm::vec3 center = meshletTriangles.empty() ? glm::vec3(0.0f) : centroidSum / static_cast<float>(meshletTriangles.size());
+			int   best = -1;
+			float bestScore = FLT_MAX;
+			for (size_t cx = 0; cx < candidates.size(); ) {
+				uint32_t candidate = candidates[cx];
+				if (emitted[candidate]) {
+					candidates[cx] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				const uint32_t* triangle = &data.Indices[candidate * 3];
+				size_t added = (vertexMeshlet[triangle[0]] != id) + (vertexMeshlet[triangle[1]] != id) + (vertexMeshlet[triangle[2]] != id);
+				if (meshletVertices + added <= options.MaxVertices) {
+					float score = added +
+						options.ConeWeight * (1.0f - glm::dot(normals[candidate], axis)) +
+						glm::length(centroids[candidate] - center) / meshletRadius;
+					if (score < bestScore) {
+						bestScore = score;
+						best = static_cast<int>(candidate);
+					}
+				}
+				cx++;
+			}
+
+			// If nothing touches the meshlet we carry on with the next triangle in the index buffer, which the
+			// cache optimizer usually leaves close to the ones we just used. If it's far away it starts a new meshlet
+			if (best < 0) {
+				if (!candidates.empty() || meshletVertices + 3 > options.MaxVertices)
+					break;
+				while (nextSeed < triangleCount && emitted[nextSeed])
+					nextSeed++;
+				if (nextSeed == triangleCount)
+					break;
+				if (!meshletTriangles.empty() && glm::length(centroids[nextSeed] - center) > meshletRadius)
+					break;
+				best = static_cast<int>(nextSeed);
+			}
+
+			emitted[best] = true;
+			meshletTriangles.push_back(best);
+			normalSum   += normals[best];
+			centroidSum += centroids[best];
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t vertex = data.Indices[best * 3 + corner];
+				indices.push_back(vertex);
+				if (vertexMeshlet[vertex] == id)
+					continue;
+				vertexMeshlet[vertex] = id;
+				meshletVertices++;
+				for (uint32_t ax = adjacencyOffsets[vertex]; ax < adjacencyOffsets[vertex + 1]; ax++)
+					if (!emitted[adjacency[ax]])
+						candidates.push_back(adjacency[ax]);
+			}
+		}
+
+		Meshlet meshlet;
+		meshlet.IndexCount  = static_cast<uint32_t>(meshletTriangles.size() * 3);
+		meshlet.IndexOffset = static_cast<uint32_t>(indices.size()) - meshlet.IndexCount;
+		meshlet.VertexCount = static_cast<uint32_t>(meshletVertices);
+
+		// Bound the meshlet with a sphere around the center of its box
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		for (uint32_t ix = meshlet.IndexOffset; ix < meshlet.IndexOffset + meshlet.IndexCount; ix++) {
+			min = glm::min(min, positionOf(indices[ix]));
+			max = glm::max(max, positionOf(indices[ix]));
+		}
+		meshlet.Center = (min + max) * 0.5f;
+		meshlet.Radius = 0.0f;
+		for (uint32_t ix = meshlet.IndexOffset; ix < meshlet.IndexOffset + meshlet.IndexCount; ix++)
+			meshlet.Radius = glm::max(meshlet.Radius, glm::length(positionOf(indices[ix]) - meshlet.Center));
+
+		// The cone is as wide as the triangle that strays furthest from the average normal. Once that passes 90
+		// degrees there's no direction that sees only the backs of the triangles, so we turn cone culling off
+		float minDot = 1.0f;
+		meshlet.ConeAxis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f, 0.0f, 1.0f);
+		for (uint32_t triangle : meshletTriangles)
+			if (normals[triangle] != glm::vec3(0.0f))
+				minDot = glm::min(minDot, glm::dot(normals[triangle], meshlet.ConeAxis));
+		meshlet.ConeCutoff = minDot <= 0.0f ? 1.0f : sqrtf(1.0f - minDot * minDot);
+		result.push_back(meshlet);
+	}
+
+	data.Indices = std::move(indices);
+	return result;
+}
+
+MeshOptimizeReport MeshOptimizer::Optimize(MeshData& data, const MeshOptimizeOptions& options) {
+	MeshOptimizeReport result;
+	result.Before = AnalyzeVertexCache(data.Indices.data(), data.Indices.size(), data.Vertices.size(), options.CacheSize);
+	// Non-indexed meshes can't share vertices, so there's nothing for us to do
+	if (data.Indices.empty()) {
+		result.After = result.Before;
+		return result;
+	}
+
+	std::vector<uint32_t> clusters;
+	OptimizeVertexCache(data.Indices, data.Vertices.size(), options.CacheSize, options.OptimizeOverdraw ? &clusters : nullptr);
+	if (options.OptimizeOverdraw)
+		OptimizeOverdraw(data, clusters, options.CacheSize, options.OverdrawThreshold);
+	if (options.OptimizeFetch)
+		OptimizeVertexFetch(data);
+
+	result.After = AnalyzeVertexCache(data.Indices.data(), data.Indices.size(), data.Vertices.size(), options.CacheSize);
+	return result;
+}
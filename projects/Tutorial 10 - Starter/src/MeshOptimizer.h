@@ -0,0 +1,140 @@
+/*
+	Post-load optimizations for MeshData, which reorder the triangles and vertices of a mesh so that the GPU
+	can make better use of its post-transform vertex cache, reject more hidden pixels, and fetch vertices
+	from memory in order. None of these change what the mesh looks like, only the order it is drawn in
+*/
+#pragma once
+
+#include "Mesh.h"
+
+/*
+ * The results of simulating how a mesh's index buffer uses the post-transform vertex cache
+ */
+struct VertexCacheStats {
+	/*
+	 * The number of vertices that missed the cache, and had to be transformed
+	 */
+	size_t Misses = 0;
+	/*
+	 * Average Cache Miss Ratio, the number of vertices transformed per triangle. This is 3 for a mesh
+	 * with no reuse, and approaches 0.5 for a perfectly ordered regular grid
+	 */
+	float  ACMR   = 0.0f;
+	/*
+	 * Average Transform to Vertex Ratio, the number of vertices transformed per unique vertex. This is 1
+	 * if every vertex is only ever transformed once, which makes it easier to compare between meshes
+	 */
+	float  ATVR   = 0.0f;
+};
+
+/*
+ * Settings for which optimizations should be run on a mesh
+ */
+struct MeshOptimizeOptions {
+	/*
+	 * The number of entries in the FIFO cache that we optimize for and simulate. Most hardware has a cache
+	 * of at least 16 entries, optimizing for a cache that is a little too small costs very little
+	 */
+	size_t CacheSize         = 16;
+	/*
+	 * True if clusters of triangles should be sorted to draw outward facing triangles first
+	 */
+	bool   OptimizeOverdraw  = true;
+	/*
+	 * How much worse the ACMR of the mesh is allowed to get to create more clusters for overdraw sorting,
+	 * 1.05 allows a 5% increase
+	 */
+	float  OverdrawThreshold = 1.05f;
+	/*
+	 * True if vertices should be reordered to match the order that the index buffer uses them in
+	 */
+	bool   OptimizeFetch     = true;
+};
+
+/*
+ * Settings for splitting a mesh into meshlets
+ */
+struct MeshletOptions {
+	/*
+	 * The most vertices and triangles a meshlet may have. 64 and 124 match what mesh shader hardware prefers, and
+	 * keep meshlets small enough to cull precisely
+	 */
+	size_t MaxVertices  = 64;
+	size_t MaxTriangles = 124;
+	/*
+	 * How much we favour triangles that face the same way as the rest of the meshlet over triangles that add fewer
+	 * vertices. Higher values make tighter normal cones (so more back face culling) but more meshlets
+	 */
+	float  ConeWeight   = 0.25f;
+};
+
+/*
+ * The vertex cache statistics of a mesh before and after it was optimized
+ */
+struct MeshOptimizeReport {
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+class MeshOptimizer {
+public:
+	/*
+	 * Simulates a FIFO post-transform vertex cache over the given index buffer
+	 * @param indices     The index buffer to analyze, every 3 indices are a triangle
+	 * @param indexCount  The number of indices in the buffer
+	 * @param vertexCount The number of vertices that the indices refer to
+	 * @param cacheSize   The number of entries in the simulated cache
+	 * @returns The cache miss statistics for the index buffer
+	 */
+	static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = 16);
+
+	/*
+	 * Reorders the triangles in the given index buffer so that vertices get reused while they are still in
+	 * the cache, using the Tipsify algorithm (Sander et al. 2007), which runs in linear time
+	 * @param indices     The index buffer to reorder in place
+	 * @param vertexCount The number of vertices that the indices refer to
+	 * @param cacheSize   The number of entries in the cache to optimize for
+	 * @param clusters    If not null, will be filled with the triangle offsets where the optimizer had to
+	 *                    jump to a new area of the mesh (starting with 0). These are used for overdraw sorting
+	 */
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16, std::vector<uint32_t>* clusters = nullptr);
+
+	/*
+	 * Sorts clusters of triangles so that the ones facing away from the center of the mesh get drawn first,
+	 * since those are the most likely to hide other triangles. Clusters will be split further where it is cheap
+	 * to do so, as long as the ACMR does not get worse than threshold times the cache optimized ACMR
+	 * @param data      The mesh to reorder the triangles of, should already be cache optimized
+	 * @param clusters  The cluster offsets returned by OptimizeVertexCache
+	 * @param cacheSize The number of entries in the cache to optimize for
+	 * @param threshold How much the ACMR is allowed to increase (1.05 is 5%)
+	 */
+	static void OptimizeOverdraw(MeshData& data, const std::vector<uint32_t>& clusters, size_t cacheSize = 16, float threshold = 1.05f);
+
+	/*
+	 * Reorders the vertices of a mesh into the order that they are first used by the index buffer, so that
+	 * the GPU reads through the vertex buffer linearly. Vertices that are never used get removed
+	 * @param data The mesh to reorder the vertices of
+	 */
+	static void OptimizeVertexFetch(MeshData& data);
+
+	/*
+	 * Splits a mesh into meshlets by reordering its triangles so that each meshlet's triangles are next to each
+	 * other in the index buffer. Meshlets are grown greedily from neighbouring triangles, preferring the ones that
+	 * add the fewest new vertices. Run this after Optimize, since overdraw sorting would break the meshlets apart
+	 * @param data      The mesh to split up, its indices will be reordered
+	 * @param options   The limits for each meshlet
+	 * @param positions Optional, the positions to compute bounds and cones from instead of the vertex positions,
+	 *                  for meshes that get displaced in their shaders
+	 * @returns The meshlets, in index buffer order
+	 */
+	static std::vector<Meshlet> BuildMeshlets(MeshData& data, const MeshletOptions& options = MeshletOptions(),
+		const std::vector<glm::vec3>* positions = nullptr);
+
+	/*
+	 * Runs all of the enabled optimizations on a mesh
+	 * @param data    The mesh to optimize
+	 * @param options The optimizations to run
+	 * @returns The vertex cache statistics before and after optimizing
+	 */
+	static MeshOptimizeReport Optimize(MeshData& data, const MeshOptimizeOptions& options = MeshOptimizeOptions());
+};
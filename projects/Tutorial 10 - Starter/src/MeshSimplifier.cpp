@@ -0,0 +1,367 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+// How much more an open border resists moving than the surface around it
+static const double BorderWeight = 10.0;
+
+/*
+ * A symmetric 4x4 matrix that measures the sum of squared distances from a point to a set of planes, weighted
+ * by the area of the triangles the planes came from. Only the upper triangle of the matrix is stored
+ */
+struct Quadric {
+	double A00, A01, A02, A11, A12, A22;
+	double B0, B1, B2;
+	double C;
+	double Weight;
+
+	Quadric() :
+		A00(0), A01(0), A02(0), A11(0), A12(0), A22(0),
+		B0(0), B1(0), B2(0),
+		C(0), Weight(0) { }
+
+	// Makes the quadric for the plane through point with the given unit normal
+	static Quadric FromPlane(const glm::vec3& normal, const glm::vec3& point, double weight) {
+		Quadric result;
+		double a = normal.x, b = normal.y, c = normal.z;
+		double d = -glm::dot(normal, point);
+		result.A00 = a * a * weight; result.A01 = a * b * weight; result.A02 = a * c * weight;
+		result.A11 = b * b * weight; result.A12 = b * c * weight;
+		result.A22 = c * c * weight;
+		result.B0 = a * d * weight; result.B1 = b * d * weight; result.B2 = c * d * weight;
+		result.C = d * d * weight;
+		result.Weight = weight;
+		return result;
+	}
+
+	Quadric& operator +=(const Quadric& other) {
+		A00 += other.A00; A01 += other.A01; A02 += other.A02;
+		A11 += other.A11; A12 += other.A12;
+		A22 += other.A22;
+		B0 += other.B0; B1 += other.B1; B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+		return *this;
+	}
+
+	// Gets the weighted sum of squared distances from the point to our planes
+	double Evaluate(const glm::vec3& point) const {
+		double x = point.x, y = point.y, z = point.z;
+		double result =
+			A00 * x * x + 2 * A01 * x * y + 2 * A02 * x * z +
+			A11 * y * y + 2 * A12 * y * z +
+			A22 * z * z +
+			2 * (B0 * x + B1 * y + B2 * z) + C;
+		return result < 0 ? -result : result;
+	}
+};
+
+// How a vertex is allowed to move during simplification
+enum class VertexKind : uint8_t {
+	Manifold, // Can collapse onto any neighbour
+	Border,   // On an open edge, can only slide along that edge
+	Locked    // On a seam or a non-manifold edge, never moves
+};
+
+// A possible collapse of one vertex onto another
+struct Collapse {
+	float    Cost;
+	uint32_t From;
+	uint32_t To;
+};
+
+// Packs an undirected edge between two positions into a single key
+static uint64_t EdgeKey(uint32_t a, uint32_t b) {
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// Counts how many of the given triangles use each edge, keyed by welded position
+static void CountEdges(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionIds, std::unordered_map<uint64_t, uint32_t>& result) {
+	result.clear();
+	result.reserve(indices.size());
+	for (size_t ix = 0; ix < indices.size(); ix += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = positionIds[indices[ix + corner]];
+			uint32_t b = positionIds[indices[ix + (corner + 1) % 3]];
+			result[EdgeKey(a, b)]++;
+		}
+	}
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const MeshData& data, size_t targetIndexCount, float maxError,
+	float* resultError, const std::vector<glm::vec3>* errorPositions)
+{
+	size_t vertexCount = data.Vertices.size();
+	std::vector<uint32_t> indices = data.Indices;
+	if (resultError != nullptr)
+		*resultError = 0.0f;
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+		return indices;
+
+	std::vector<glm::vec3> positions;
+	if (errorPositions == nullptr) {
+		positions.resize(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++)
+			positions[ix] = data.Vertices[ix].Position;
+	}
+	const std::vector<glm::vec3>& P = errorPositions != nullptr ? *errorPositions : positions;
+
+	// Vertices that only differ by their other attributes (ex: UV seams) share a position, we weld those together
+	// so that we can find the real topology of the surface
+	std::vector<uint32_t> positionIds(vertexCount);
+	std::vector<uint32_t> wedgeCounts;
+	{
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				return std::hash<float>()(p.x) ^ (std::hash<float>()(p.y) * 31) ^ (std::hash<float>()(p.z) * 131);
+			}
+		};
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> welded;
+		welded.reserve(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			auto it = welded.emplace(P[ix], static_cast<uint32_t>(wedgeCounts.size()));
+			if (it.second)
+				wedgeCounts.push_back(0);
+			positionIds[ix] = it.first->second;
+			wedgeCounts[positionIds[ix]]++;
+		}
+	}
+
+	std::unordered_map<uint64_t, uint32_t> edgeCounts;
+	CountEdges(indices, positionIds, edgeCounts);
+
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+	for (size_t ix = 0; ix < vertexCount; ix++)
+		if (wedgeCounts[positionIds[ix]] > 1)
+			kinds[ix] = VertexKind::Locked;
+	for (size_t ix = 0; ix < indices.size(); ix += 3) {
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = indices[ix + corner];
+			uint32_t b = indices[ix + (corner + 1) % 3];
+			uint32_t count = edgeCounts[EdgeKey(positionIds[a], positionIds[b])];
+			for (uint32_t vertex : { a, b }) {
+				if (count > 2)
+					kinds[vertex] = VertexKind::Locked;
+				else if (count == 1 && kinds[vertex] == VertexKind::Manifold)
+					kinds[vertex] = VertexKind::Border;
+			}
+		}
+	}
+
+	// Every vertex starts with the planes of the triangles around it, and open edges get an extra plane standing
+	// up along the edge, which keeps the outline of the mesh from shrinking
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t ix = 0; ix < indices.size(); ix += 3) {
+		const glm::vec3& p0 = P[indices[ix]];
+		glm::vec3 normal = glm::cross(P[indices[ix + 1]] - p0, P[indices[ix + 2]] - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f)
+			continue;
+		normal /= length;
+		Quadric plane = Quadric::FromPlane(normal, p0, length * 0.5);
+		for (int corner = 0; corner < 3; corner++)
+			quadrics[indices[ix + corner]] += plane;
+
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t a = indices[ix + corner];
+			uint32_t b = indices[ix + (corner + 1) % 3];
+			if (edgeCounts[EdgeKey(positionIds[a], positionIds[b])] != 1)
+				continue;
+			glm::vec3 edge = P[b] - P[a];
+			float edgeLength = glm::length(edge);
+			if (edgeLength == 0.0f)
+				continue;
+			glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+			Quadric border = Quadric::FromPlane(edgeNormal, P[a], edgeLength * edgeLength * BorderWeight);
+			quadrics[a] += border;
+			quadrics[b] += border;
+		}
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<bool>     locked(vertexCount);
+	std::vector<uint32_t> remap(vertexCount);
+	double maxCost     = static_cast<double>(maxError) * maxError;
+	double appliedCost = 0.0;
+	size_t targetTriangles = targetIndexCount / 3;
+	size_t triangleCount   = indices.size() / 3;
+
+	// We make several passes over the mesh, each one collapsing the cheapest edges that don't touch each other
+	while (triangleCount > targetTriangles) {
+		// Build our vertex to triangle adjacency for the triangles that are left
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t vertex : indices)
+			adjacencyOffsets[vertex + 1]++;
+		for (size_t ix = 0; ix < vertexCount; ix++)
+			adjacencyOffsets[ix + 1] += adjacencyOffsets[ix];
+		adjacency.resize(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t ix = 0; ix < indices.size(); ix++)
+				adjacency[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+		}
+
+		// An edge is on the border if only one triangle around one end touches the other end. Collapses never open
+		// up new borders, so we only need to look when one of the ends started out on a border
+		auto isBorderEdge = [&](uint32_t a, uint32_t b) {
+			if (kinds[a] == VertexKind::Manifold || kinds[b] == VertexKind::Manifold)
+				return false;
+			uint32_t count = 0;
+			for (uint32_t ax = adjacencyOffsets[a]; ax < adjacencyOffsets[a + 1]; ax++) {
+				const uint32_t* triangle = &indices[adjacency[ax] * 3];
+				for (int corner = 0; corner < 3; corner++)
+					count += positionIds[triangle[corner]] == positionIds[b];
+			}
+			return count == 1;
+		};
+
+		// Every interior edge shows up once in each direction across its two triangles, border edges only show up
+		// once so we add their other direction ourselves
+		collapses.clear();
+		for (size_t ix = 0; ix < indices.size(); ix += 3) {
+			for (int corner = 0; corner < 3; corner++) {
+				uint32_t a = indices[ix + corner];
+				uint32_t b = indices[ix + (corner + 1) % 3];
+				bool isBorder = isBorderEdge(a, b);
+				for (int direction = 0; direction < (isBorder ? 2 : 1); direction++) {
+					uint32_t from = direction == 0 ? a : b;
+					uint32_t to   = direction == 0 ? b : a;
+					if (kinds[from] == VertexKind::Locked || (kinds[from] == VertexKind::Border && !isBorder))
+						continue;
+					Quadric sum = quadrics[from];
+					sum += quadrics[to];
+					double cost = sum.Evaluate(P[to]) / std::max(sum.Weight, 1e-12);
+					if (cost <= maxCost)
+						collapses.push_back({ static_cast<float>(cost), from, to });
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		// Once the cheap collapses start locking each other out, we would rather wait for the next pass than take
+		// much more expensive ones, so each pass stops a little past the cost that would get us to our target. That
+		// means we only need to sort the collapses under that cost
+		auto byCost = [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; };
+		size_t collapseGoal = std::min((triangleCount - targetTriangles) / 2, collapses.size() - 1);
+		std::nth_element(collapses.begin(), collapses.begin() + collapseGoal, collapses.end(), byCost);
+		float costGoal = collapses[collapseGoal].Cost * 1.5f;
+		auto  sortEnd  = std::partition(collapses.begin() + collapseGoal, collapses.end(), [=](const Collapse& c) { return c.Cost <= costGoal; });
+		collapses.erase(sortEnd, collapses.end());
+		std::sort(collapses.begin(), collapses.end(), byCost);
+
+		std::fill(locked.begin(), locked.end(), false);
+		for (size_t ix = 0; ix < vertexCount; ix++)
+			remap[ix] = static_cast<uint32_t>(ix);
+
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (triangleCount <= targetTriangles)
+				break;
+			uint32_t from = collapse.From;
+			uint32_t to   = collapse.To;
+			if (locked[from] || locked[to])
+				continue;
+
+			// Make sure that moving the vertex won't flip any of the triangles that survive the collapse
+			bool flips = false;
+			size_t removed = 0;
+			for (uint32_t ax = adjacencyOffsets[from]; ax < adjacencyOffsets[from + 1] && !flips; ax++) {
+				const uint32_t* triangle = &indices[adjacency[ax] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+					removed++;
+					continue;
+				}
+				glm::vec3 before[3], after[3];
+				for (int corner = 0; corner < 3; corner++) {
+					before[corner] = P[triangle[corner]];
+					after[corner]  = triangle[corner] == from ? P[to] : before[corner];
+				}
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter  = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+			if (flips)
+				continue;
+
+			remap[from] = to;
+			quadrics[to] += quadrics[from];
+			appliedCost = std::max(appliedCost, static_cast<double>(collapse.Cost));
+			triangleCount -= removed;
+			applied++;
+
+			// The triangles around the vertex have changed shape, so none of their vertices can move again this pass
+			for (uint32_t ax = adjacencyOffsets[from]; ax < adjacencyOffsets[from + 1]; ax++) {
+				const uint32_t* triangle = &indices[adjacency[ax] * 3];
+				locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = true;
+			}
+		}
+		if (applied == 0)
+			break;
+
+		// Apply the collapses, dropping the triangles that have lost an edge
+		size_t write = 0;
+		for (size_t ix = 0; ix < indices.size(); ix += 3) {
+			uint32_t a = remap[indices[ix]], b = remap[indices[ix + 1]], c = remap[indices[ix + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+		triangleCount = write / 3;
+	}
+
+	if (resultError != nullptr)
+		*resultError = static_cast<float>(sqrt(appliedCost));
+	return indices;
+}
+
+std::vector<MeshLodLevel> MeshSimplifier::BuildLodChain(const MeshData& data, const LodChainOptions& options,
+	const std::vector<glm::vec3>* errorPositions)
+{
+	std::vector<MeshLodLevel> result;
+	result.reserve(options.LevelCount);
+	result.push_back({ data, 0.0f });
+	if (data.Vertices.empty())
+		return result;
+
+	// Our error limit scales with the size of the mesh, so find the radius of its bounds
+	glm::vec3 min = errorPositions != nullptr ? (*errorPositions)[0] : data.Vertices[0].Position;
+	glm::vec3 max = min;
+	for (size_t ix = 0; ix < data.Vertices.size(); ix++) {
+		const glm::vec3& position = errorPositions != nullptr ? (*errorPositions)[ix] : data.Vertices[ix].Position;
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	float maxError = glm::length(max - min) * 0.5f * options.MaxError;
+
+	// Every level is simplified from the full mesh rather than the level before it, so that errors don't pile up
+	float  target = static_cast<float>(data.Indices.size());
+	size_t previousCount = data.Indices.size();
+	for (size_t level = 1; level < options.LevelCount; level++) {
+		target *= options.Ratio;
+		float error = 0.0f;
+		std::vector<uint32_t> indices = Simplify(data, static_cast<size_t>(target) / 3 * 3, maxError, &error, errorPositions);
+		// Once the simplifier hits the error limit, more levels would just be copies of this one
+		if (indices.empty() || indices.size() > previousCount * 9 / 10)
+			break;
+
+		MeshLodLevel lod;
+		lod.Data.Vertices = data.Vertices;
+		lod.Data.Indices  = std::move(indices);
+		lod.Error = std::max(error, result.back().Error);
+		if (options.Optimize)
+			MeshOptimizer::Optimize(lod.Data);
+		else
+			MeshOptimizer::OptimizeVertexFetch(lod.Data);
+		previousCount = lod.Data.Indices.size();
+		result.push_back(std::move(lod));
+	}
+	return result;
+}
@@ -0,0 +1,74 @@
+/*
+	Builds lower detail versions of a mesh with quadric error metric edge collapses (Garland & Heckbert).
+	Every collapse moves a vertex onto one of its neighbours, so the simplified meshes only ever use vertices
+	from the original mesh, and we only need to produce new index buffers. Vertices on UV seams are locked
+	in place, and vertices on open borders can only slide along the border, so that the outline and the
+	texturing of the mesh are kept intact
+*/
+#pragma once
+
+#include "Mesh.h"
+
+/*
+ * Settings for building a chain of LOD levels
+ */
+struct LodChainOptions {
+	/*
+	 * The number of levels to build, including the full detail mesh as level 0
+	 */
+	size_t LevelCount = 4;
+	/*
+	 * The number of triangles in each level, relative to the level before it
+	 */
+	float  Ratio      = 0.5f;
+	/*
+	 * The largest error we will accept in any level, relative to the radius of the mesh. Levels stop getting
+	 * simpler once they reach this error, and levels that can't get any simpler are left out
+	 */
+	float  MaxError   = 0.05f;
+	/*
+	 * True if each level should be run through MeshOptimizer
+	 */
+	bool   Optimize   = true;
+};
+
+/*
+ * A single level in a LOD chain
+ */
+struct MeshLodLevel {
+	/*
+	 * The mesh data for the level, only the vertices that the level uses are kept
+	 */
+	MeshData Data;
+	/*
+	 * The furthest (in model space units) that the level's surface strays from the full detail mesh
+	 */
+	float    Error = 0.0f;
+};
+
+class MeshSimplifier {
+public:
+	/*
+	 * Simplifies a mesh until it reaches the target number of indices, or until any further collapse
+	 * would exceed the maximum error
+	 * @param data             The mesh to simplify
+	 * @param targetIndexCount The number of indices we are aiming for
+	 * @param maxError         The largest error (in model space units) that a collapse may introduce
+	 * @param resultError      Optional, will store the error of the simplified mesh
+	 * @param errorPositions   Optional, positions for each vertex to measure error with instead of the vertex
+	 *                         positions, for meshes that get displaced in their shaders
+	 * @returns The index buffer for the simplified mesh, which indexes into data's vertices
+	 */
+	static std::vector<uint32_t> Simplify(const MeshData& data, size_t targetIndexCount, float maxError,
+		float* resultError = nullptr, const std::vector<glm::vec3>* errorPositions = nullptr);
+
+	/*
+	 * Builds a chain of progressively simpler versions of a mesh
+	 * @param data           The full detail mesh
+	 * @param options        The settings for the chain
+	 * @param errorPositions Optional, positions for each vertex to measure error with (see Simplify)
+	 * @returns The levels of the chain, starting with the full detail mesh
+	 */
+	static std::vector<MeshLodLevel> BuildLodChain(const MeshData& data, const LodChainOptions& options = LodChainOptions(),
+		const std::vector<glm::vec3>* errorPositions = nullptr);
+};
@@ -0,0 +1,81 @@
+#include "Meshlet.h"
+
+Frustum Frustum::FromMatrix(const glm::mat4& matrix) {
+	// GLM is column major, so pull out the rows of the matrix first
+	glm::vec4 rows[4];
+	for (int ix = 0; ix < 4; ix++)
+		rows[ix] = glm::vec4(matrix[0][ix], matrix[1][ix], matrix[2][ix], matrix[3][ix]);
+
+	Frustum result;
+	result.Planes[0] = rows[3] + rows[0]; // Left
+	result.Planes[1] = rows[3] - rows[0]; // Right
+	result.Planes[2] = rows[3] + rows[1]; // Bottom
+	result.Planes[3] = rows[3] - rows[1]; // Top
+	result.Planes[4] = rows[3] + rows[2]; // Near
+	result.Planes[5] = rows[3] - rows[2]; // Far
+	// Normalizing the planes lets us compare their distances against a radius
+	for (glm::vec4& plane : result.Planes)
+		plane /= glm::length(glm::vec3(plane));
+	return result;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : Planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+MeshletCullView MeshletCullView::Create(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+	MeshletCullView result;
+	result.Frustum = Frustum::FromMatrix(projection * view * model);
+
+	// The camera sits at the origin of view space looking down -Z, we bring that back into model space
+	glm::mat4 viewToModel = glm::inverse(model) * glm::inverse(view);
+	result.CameraPosition = glm::vec3(viewToModel * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	result.ViewDirection  = glm::normalize(glm::vec3(viewToModel * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+	result.IsOrthographic = projection[2][3] == 0.0f;
+	return result;
+}
+
+size_t MeshletCuller::Cull(const std::vector<Meshlet>& meshlets, const MeshletCullView& view, std::vector<MeshletRange>& ranges, MeshletCullStats* stats) {
+	ranges.clear();
+	size_t frustumCulled = 0, backfaceCulled = 0;
+
+	for (const Meshlet& meshlet : meshlets) {
+		if (!view.Frustum.IntersectsSphere(meshlet.Center, meshlet.Radius)) {
+			frustumCulled++;
+			continue;
+		}
+
+		// Every triangle faces away from the camera if the direction we see the meshlet from is within the cone's
+		// cutoff of its axis. For perspective cameras we account for seeing the sphere from slightly different directions
+		if (meshlet.ConeCutoff < 1.0f) {
+			bool backfacing;
+			if (view.IsOrthographic)
+				backfacing = glm::dot(view.ViewDirection, meshlet.ConeAxis) >= meshlet.ConeCutoff;
+			else {
+				glm::vec3 toMeshlet = meshlet.Center - view.CameraPosition;
+				backfacing = glm::dot(toMeshlet, meshlet.ConeAxis) >= meshlet.ConeCutoff * glm::length(toMeshlet) + meshlet.Radius;
+			}
+			if (backfacing) {
+				backfaceCulled++;
+				continue;
+			}
+		}
+
+		// Neighbouring meshlets are next to each other in the index buffer, so we can draw runs of them at once
+		if (!ranges.empty() && ranges.back().IndexOffset + ranges.back().IndexCount == meshlet.IndexOffset)
+			ranges.back().IndexCount += meshlet.IndexCount;
+		else
+			ranges.push_back({ meshlet.IndexOffset, meshlet.IndexCount });
+	}
+
+	if (stats != nullptr) {
+		stats->Total    += meshlets.size();
+		stats->Frustum  += frustumCulled;
+		stats->Backface += backfaceCulled;
+	}
+	return meshlets.size() - frustumCulled - backfaceCulled;
+}
@@ -0,0 +1,94 @@
+/*
+	Meshlets are small clusters of neighbouring triangles that are stored one after the other in a mesh's index
+	buffer. Each one knows the sphere that bounds it and the cone that its triangles face into, which lets us skip
+	whole clusters that are outside of the view frustum or facing away from the camera before we draw. None of this
+	touches OpenGL, so culling can be run (and tested) without a context
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+/*
+ * A cluster of triangles in a mesh's index buffer, see MeshOptimizer::BuildMeshlets
+ */
+struct Meshlet {
+	// The range of the mesh's index buffer that this meshlet covers
+	uint32_t  IndexOffset;
+	uint32_t  IndexCount;
+	// The number of unique vertices that the meshlet uses
+	uint32_t  VertexCount;
+	// The bounding sphere of the meshlet in model space
+	glm::vec3 Center;
+	float     Radius;
+	// The average facing of the meshlet's triangles, and the sine of the largest angle any of them stray from it.
+	// A cutoff of 1 means the triangles face too many ways for the meshlet to ever be back facing
+	glm::vec3 ConeAxis;
+	float     ConeCutoff;
+};
+
+/*
+ * A range of indices to draw, neighbouring meshlets that are all visible get merged into a single range
+ */
+struct MeshletRange {
+	uint32_t IndexOffset;
+	uint32_t IndexCount;
+};
+
+/*
+ * The 6 planes of a view frustum, with their normals pointing inwards
+ */
+struct Frustum {
+	glm::vec4 Planes[6];
+
+	/*
+	 * Extracts the planes from a projection matrix (Gribb & Hartmann). Passing a model view projection matrix
+	 * gives us planes in model space
+	 */
+	static Frustum FromMatrix(const glm::mat4& matrix);
+
+	// Returns true if any part of the given sphere is inside of the frustum
+	bool IntersectsSphere(const glm::vec3& center, float radius) const;
+};
+
+/*
+ * Everything we need to know about a camera to cull meshlets, in the model space of the mesh being drawn
+ */
+struct MeshletCullView {
+	::Frustum Frustum;
+	glm::vec3 CameraPosition;
+	// The direction the camera is looking in, used instead of the position for orthographic cameras
+	glm::vec3 ViewDirection;
+	bool      IsOrthographic;
+
+	/*
+	 * Makes the view for drawing a mesh with a camera
+	 * @param model      The world transform of the mesh
+	 * @param view       The camera's view matrix
+	 * @param projection The camera's projection matrix
+	 */
+	static MeshletCullView Create(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
+};
+
+/*
+ * The number of meshlets that were culled, and why
+ */
+struct MeshletCullStats {
+	size_t Total    = 0;
+	size_t Frustum  = 0;
+	size_t Backface = 0;
+};
+
+class MeshletCuller {
+public:
+	/*
+	 * Finds the meshlets that could be visible from the given view
+	 * @param meshlets The meshlets of the mesh, in index buffer order
+	 * @param view     The camera to cull against, see MeshletCullView::Create
+	 * @param ranges   Will be filled with the index ranges that should be drawn
+	 * @param stats    Optional, the culled meshlets will be added to these
+	 * @returns The number of meshlets that survived culling
+	 */
+	static size_t Cull(const std::vector<Meshlet>& meshlets, const MeshletCullView& view, std::vector<MeshletRange>& ranges, MeshletCullStats* stats = nullptr);
+};
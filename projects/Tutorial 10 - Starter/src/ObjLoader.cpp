@@ -4,195 +4,703 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <sstream>
-#include <filesystem>
-#include <regex>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
 
+#include "FileStream.h"
 #include "Logging.h"
+#include "Sys.h"
+#include "ThreadPool.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+#include "VertexHashTable.h"
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/normal.hpp>
 
-// Borrowed from https://stackoverflow.com/questions/216823/whats-the-best-way-to-trim-stdstring
-#pragma region String Trimming
+// We'll just use a 3x3 matrix of integers to represent the face
+// Thanks to Myles for showing me this! It's an awesome idea!
+typedef glm::mat<3, 3, uint32_t> Face;
 
-// trim from start (in place)
-static inline void ltrim(std::string& s) {
-	s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch) {
-		return !std::isspace(ch);
-		}));
+#pragma region OBJ Tokenizing
+
+// Returns true if the character separates tokens within a line
+static inline bool IsBlank(char c) {
+	return c == ' ' || c == '\t';
+}
+
+// Returns true if the character ends a line (we treat the \r in \r\n line endings as the end of the line)
+static inline bool IsLineEnd(char c) {
+	return c == '\n' || c == '\r';
+}
+
+// Advances the cursor past any spaces or tabs, without leaving the current line
+static inline const char* SkipBlanks(const char* cursor, const char* end) {
+	while (cursor < end && IsBlank(*cursor))
+		cursor++;
+	return cursor;
 }
 
-// trim from end (in place)
-static inline void rtrim(std::string& s) {
-	s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch) {
-		return !std::isspace(ch);
-		}).base(), s.end());
+// Advances the cursor to the first character of the next line
+static inline const char* SkipLine(const char* cursor, const char* end) {
+	const char* newLine = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+	return newLine != nullptr ? newLine + 1 : end;
+}
+
+// Reads a float at the cursor, leaving the result untouched if there is no number to read
+static inline const char* ParseFloat(const char* cursor, const char* end, float& result) {
+	cursor = SkipBlanks(cursor, end);
+	// from_chars does not accept a leading plus sign (but streams did), so we skip over it
+	if (cursor < end && *cursor == '+')
+		cursor++;
+	return std::from_chars(cursor, end, result).ptr;
+}
+
+// Reads a face vertex in the form v, v/t, v//n or v/t/n. Any missing index is left as 0, which will map
+// to -1 (no attribute) once converted to our index space. Returns the cursor unchanged if nothing was read
+static inline const char* ParseFaceVertex(const char* cursor, const char* end, int32_t result[3]) {
+	result[0] = result[1] = result[2] = 0;
+	for (int ix = 0; ix < 3; ix++) {
+		cursor = std::from_chars(cursor, end, result[ix]).ptr;
+		// Only continue to the next bucket if we have a slash separator
+		if (ix < 2 && cursor < end && *cursor == '/')
+			cursor++;
+		else
+			break;
+	}
+	return cursor;
 }
 
-// trim from both ends (in place)
-static inline void trim(std::string& s) {
-	ltrim(s);
-	rtrim(s);
+// Converts a 1-based OBJ index into our 0-based index space. Negative (relative) indices are resolved
+// against the number of attributes read so far in the chunk, and will need to be shifted by the chunk's offset
+// once we know it. A zero index becomes -1 (not provided)
+static inline uint32_t ResolveIndex(int32_t index, size_t count) {
+	if (index > 0)
+		return static_cast<uint32_t>(index - 1);
+	else if (index < 0)
+		return static_cast<uint32_t>(static_cast<int64_t>(count) + index);
+	else
+		return static_cast<uint32_t>(-1);
 }
 
 #pragma endregion 
 
-MeshData ObjLoader::LoadObj(const char* filename, glm::vec4 baseColor) {
-	// Open our file in binary mode
-	std::ifstream file;
-	file.open(filename, std::ios::binary);
+/*
+ * The attributes and faces read from a newline-aligned chunk of an OBJ file, as well as the result of
+ * de-duplicating the chunk's vertices
+ */
+struct ObjChunk {
+	// The range of the file buffer that this chunk covers
+	const char* Begin = nullptr;
+	const char* End   = nullptr;
 
-	// We'll just use a 3x3 matrix of integers to represent the face
-	// Thanks to Myles for showing me this! It's an awesome idea!
-	typedef glm::mat<3, 3, uint32_t> Face;
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec2> TexUvs;
+	std::vector<glm::vec3> Normals;
+	std::vector<Face>      Faces;
+	// The face components (face * 9 + vertex * 3 + attribute) that came from negative indices, these
+	// need to be shifted by our attribute offsets once we know them
+	std::vector<size_t>    RelativeFixups;
 
-	// If our file fails to open, we will throw an error
-	if (!file) {
-		throw new std::runtime_error("Failed to open file");
+	// Where this chunk's data starts in the combined attribute and face lists
+	size_t PositionOffset = 0, TexUvOffset = 0, NormalOffset = 0, FaceOffset = 0;
+
+	// The keys of the unique vertices in this chunk, in the order they were first used
+	std::vector<glm::uvec3> VertexKeys;
+	// The vertex for each of our unique keys
+	std::vector<Vertex>    Vertices;
+	// The index into our unique vertices for every face vertex in the chunk
+	std::vector<uint32_t>  Indices;
+};
+
+/*
+ * Splits the buffer into at most numChunks pieces, making sure that every chunk ends on a line break
+ */
+static std::vector<ObjChunk> SplitChunks(const char* begin, const char* end, size_t numChunks) {
+	std::vector<ObjChunk> result;
+	size_t chunkSize = (end - begin) / numChunks + 1;
+	const char* cursor = begin;
+	while (cursor < end) {
+		ObjChunk chunk;
+		chunk.Begin = cursor;
+		cursor = (size_t)(end - cursor) > chunkSize ? SkipLine(cursor + chunkSize, end) : end;
+		chunk.End = cursor;
+		result.push_back(std::move(chunk));
+	}
+	// Even an empty file needs a chunk to write results to
+	if (result.empty()) {
+		result.emplace_back();
+		result.back().Begin = result.back().End = begin;
 	}
+	return result;
+}
 
-	LOG_TRACE("Loading mesh from '{}'", filename);
+/*
+ * Reads all of the attributes and faces in a newline-aligned range of an OBJ file. Attributes are appended to
+ * the given lists, and every triangle is handed to onFace along with which of its components came from
+ * relative indices (resolved against the attributes read so far)
+ */
+template <typename FaceHandler>
+static void ParseLines(const char* cursor, const char* end, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& texUvs,
+	std::vector<glm::vec3>& normals, FaceHandler onFace)
+{
+	// Iterate as long as there is content to read, each iteration handles a single line
+	while (cursor < end) {
+		cursor = SkipBlanks(cursor, end);
+		if (cursor >= end)
+			break;
 
-	// Declare vectors for our positions, normals, and face indices
-	std::vector<glm::vec3>   positions;
-	std::vector<glm::vec2>   texUvs;
-	std::vector<glm::vec3>   normals;
-	std::vector<Face>        faces;
-	// Stores our w value if it is provided
-	float garb;
-	// Stores the line that we are operating on
-	std::string line;
-
-	// Regex for matching our face buckets
-	// https://regex101.com/r/MEKPnK/2
-	std::regex multiMatch(R"LIT((\d*)(?:\/(\d*)(?:\/(\d*))?)? (\d*)(?:\/(\d*)(?:\/(\d*))?)? (\d*)(?:\/(\d*)(?:\/(\d*))?)?)LIT");
-	std::smatch match;
-
-	// A cache for mapping face vertex indices to a mesh vertex index
-	std::unordered_map<uint64_t, int> vectorCache;
-
-	// Iterate as long as there is content to read
-	while (std::getline(file, line)) {
 		// v is our position
-		if (line.substr(0, 2) == "v ") {
-			// Read in the position and append it to our positions list
-			std::istringstream ss = std::istringstream(line.c_str() + 2);
-			glm::vec3 pos; ss >> pos.x; ss >> pos.y; ss >> pos.z; ss >> garb;
+		if (cursor[0] == 'v' && cursor + 1 < end && IsBlank(cursor[1])) {
+			// Read in the position and append it to our positions list (we ignore the w value if it is provided)
+			glm::vec3 pos = glm::vec3(0.0f);
+			cursor = ParseFloat(cursor + 2, end, pos.x);
+			cursor = ParseFloat(cursor, end, pos.y);
+			cursor = ParseFloat(cursor, end, pos.z);
 			positions.push_back(pos);
 		}
 		// vn is our normals
-		else if (line.substr(0, 3) == "vn ") {
+		else if (cursor[0] == 'v' && cursor + 2 < end && cursor[1] == 'n' && IsBlank(cursor[2])) {
 			// Read in all the normals and append to list
-			std::istringstream ss = std::istringstream(line.c_str() + 3);
-			glm::vec3 norm; ss >> norm.x; ss >> norm.y; ss >> norm.z;
+			glm::vec3 norm = glm::vec3(0.0f);
+			cursor = ParseFloat(cursor + 3, end, norm.x);
+			cursor = ParseFloat(cursor, end, norm.y);
+			cursor = ParseFloat(cursor, end, norm.z);
 			normals.push_back(norm);
 		}
 		// vt is our UV's 
-		else if (line.substr(0, 3) == "vt ") {
+		else if (cursor[0] == 'v' && cursor + 2 < end && cursor[1] == 't' && IsBlank(cursor[2])) {
 			// Read in the coordinates and append to list
-			std::istringstream ss = std::istringstream(line.c_str() + 3);
-			glm::vec2 uv; ss >> uv.x; ss >> uv.y;
+			glm::vec2 uv = glm::vec2(0.0f);
+			cursor = ParseFloat(cursor + 3, end, uv.x);
+			cursor = ParseFloat(cursor, end, uv.y);
 			texUvs.push_back(uv);
 		}
 		// f is our faces
-		else if (line.substr(0, 2) == "f ") {
-			// We will start parsing with a string stream
-			std::istringstream ss = std::istringstream(line.c_str() + 2);
-			
-			// These will store our indices to position, texture, and normals respectively
-			GLuint vInd{ 0 }, tInd{ 0 }, nInd{ 0 };
+		else if (cursor[0] == 'f' && cursor + 1 < end && IsBlank(cursor[1])) {
+			cursor += 2;
+
 			// Our face starts as all zeros
 			Face face = Face(0.0f);
+			// These will store our indices to position, texture, and normals respectively
+			int32_t raw[3];
+			// Track which components of the face came from relative indices
+			bool relative[3][3] = { };
+			int vertexCount = 0;
 
-			// Remove the first 2 characters (the 'f ')
-			line = line.substr(2);
-			// Trim any leftover whitespace characters
-			rtrim(line);
-
-			// Run the regex on the line
-			if (std::regex_match(line, match, multiMatch)) {
-				// Iterate over 3 vertices
-				for (size_t ix = 0ul; ix < 3ul; ix++) {
-					// Assume that we always have the position
-					vInd = atoi(match[(ix * 3) + 1].str().c_str());
-					// Check our texture bucket, get the index if it's set
-					if (match[(ix * 3ul) + 2ul].matched)
-						tInd = atoi(match[(ix * 3ul) + 2ul].str().c_str());
-					// Check our normal bucket, get the index if it's set
-					if (match[(ix * 3) + 3].matched)
-						nInd = atoi(match[(ix * 3ul) + 3ul].str().c_str());
-
-					// Convert to our index space and store in the face
-					vInd--; tInd--; nInd--;
-					face[ix][0] = vInd; face[ix][1] = tInd; face[ix][2] = nInd;
+			// Read vertices until the end of the line, polygons with more than 3 vertices are split into a
+			// triangle fan around the first vertex
+			while (true) {
+				cursor = SkipBlanks(cursor, end);
+				if (cursor >= end || IsLineEnd(*cursor))
+					break;
+
+				const char* next = ParseFaceVertex(cursor, end, raw);
+				// Stop if there is something on the line that isn't a face vertex (ex: a trailing comment)
+				if (next == cursor)
+					break;
+				cursor = next;
+
+				// Once we have a full triangle, we shift our last vertex down to continue the fan
+				if (vertexCount >= 3) {
+					face[1] = face[2];
+					for (int jx = 0; jx < 3; jx++)
+						relative[1][jx] = relative[2][jx];
 				}
+				int ix = vertexCount < 3 ? vertexCount : 2;
+
+				// Convert to our index space and store in the face
+				face[ix][0] = ResolveIndex(raw[0], positions.size());
+				face[ix][1] = ResolveIndex(raw[1], texUvs.size());
+				face[ix][2] = ResolveIndex(raw[2], normals.size());
+				for (int jx = 0; jx < 3; jx++)
+					relative[ix][jx] = raw[jx] < 0;
+				vertexCount++;
+
+				// Once we have face index data, pass it on to be processed
+				if (vertexCount >= 3)
+					onFace(face, relative);
 			}
-			// If our regex did not match, fail
-			else {
+
+			// If we did not get at least a triangle, fail
+			if (vertexCount < 3) {
 				LOG_ASSERT(false, "Cannot parse face!");
 			}
-			// Once we have face index data, add it to our list to be processed
-			faces.push_back(face);
 		}
+
+		// Anything else (comments, groups, materials) is skipped along with the rest of the line
+		cursor = SkipLine(cursor, end);
 	}
+}
 
-	LOG_TRACE("\tLoaded data, starting post-processing");
+/*
+ * Reads all of the attributes and faces in a chunk of an OBJ file
+ */
+static void ParseChunk(ObjChunk& chunk) {
+	ParseLines(chunk.Begin, chunk.End, chunk.Positions, chunk.TexUvs, chunk.Normals, [&](const Face& face, const bool relative[3][3]) {
+		for (int vx = 0; vx < 3; vx++)
+			for (int jx = 0; jx < 3; jx++)
+				if (relative[vx][jx])
+					chunk.RelativeFixups.push_back(chunk.Faces.size() * 9 + vx * 3 + jx);
+		chunk.Faces.push_back(face);
+	});
+}
 
-	// Allocate a new array for our vertices
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	
-	// Iterate over all the positions we've read
-	for (auto& face : faces) {
+/*
+ * Creates the vertex for one corner of a face from the attribute lists
+ */
+static inline Vertex MakeVertex(const Face& face, int corner, const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texUvs,
+	const std::vector<glm::vec3>& normals, const glm::vec4& baseColor)
+{
+	const glm::uvec3& aSet = face[corner];
+	Vertex vertex;
+	vertex.Position = 
+		aSet[0] != (uint32_t)-1 ? 
+			positions[aSet[0]] :
+			glm::vec3(0);
+	vertex.Color = baseColor;
+	vertex.UV = 
+		aSet[1] != (uint32_t)-1 ? 
+			texUvs[aSet[1]] :
+			glm::vec2(0.0f);
+	vertex.Normal = 
+		aSet[2] != (uint32_t)-1 ? 
+			normals[aSet[2]] :
+			glm::triangleNormal(positions[face[0][0]], positions[face[1][0]], positions[face[2][0]]);
+	return vertex;
+}
+
+/*
+ * Builds the unique vertices for a chunk's faces, once the attributes for the whole file are known
+ */
+static void DeduplicateChunk(ObjChunk& chunk, const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texUvs,
+	const std::vector<glm::vec3>& normals, const glm::vec4& baseColor)
+{
+	// A cache for mapping face vertex indices to a chunk vertex index. A closed mesh has about half as many
+	// vertices as faces, so we size it from the face count (it will grow if UV seams push us past that)
+	VertexHashTable vectorCache(chunk.Faces.size() / 2);
+	chunk.Indices.reserve(chunk.Faces.size() * 3);
+
+	for (auto& face : chunk.Faces) {
 		for (int jx = 0; jx < 3; jx++) {
-			auto& aSet = face[jx];
-			// We will use our mask to only select the lowest 21 bits of each index
-			uint64_t mask = 0b0'000000000000000000000'000000000000000000000'111111111111111111111;
-			uint64_t key = 0;
-			
-			// We generate a key using our vertex's position, texture, and normal indices
-			key = ((aSet[0] & mask) << 42) | ((aSet[1] & mask) << 21) | (aSet[2] & mask);
+			const glm::uvec3& aSet = face[jx];
 
-			// Search the cache for the key
-			auto it = vectorCache.find(key);
+			// Search the cache for the key, adding it with the next vertex index if it's not there
+			bool isNew = false;
+			uint32_t index = vectorCache.FindOrInsert(aSet, static_cast<uint32_t>(chunk.Vertices.size()), isNew);
 
 			// If it exists, we push the index to our indices
-			if (it != vectorCache.end())
-				indices.push_back(it->second);
+			if (!isNew)
+				chunk.Indices.push_back(index);
 			// Otherwise, we need to create a new vertex
 			else
 			{
-				// Load the vertex from the attributes
-				Vertex vertex;
-				vertex.Position = 
-					aSet[0] != (uint32_t)-1 ? 
-						positions[aSet[0]] :
-						glm::vec3(0);
-				vertex.Color = baseColor;
-				vertex.UV = 
-					aSet[1] != (uint32_t)-1 ? 
-						texUvs[aSet[1]] :
-						glm::vec2(0.0f);
-				vertex.Normal = 
-					aSet[2] != (uint32_t)-1 ? 
-						normals[aSet[2]] :
-						glm::triangleNormal(positions[face[0][0]], positions[face[1][0]], positions[face[2][0]]);
-				// Add the index of the new vertex to the cache
-				vectorCache[key] = vertices.size();
 				// Add the index of the new vertex to our indices
-				indices.push_back(vertices.size());
-				// Add the vertex to the buffer
-				vertices.push_back(vertex);
+				chunk.Indices.push_back(index);
+				// Add the vertex and its key to the buffer
+				chunk.Vertices.push_back(MakeVertex(face, jx, positions, texUvs, normals, baseColor));
+				chunk.VertexKeys.push_back(aSet);
+			}
+		}
+	}
+}
+
+/*
+ * Reads the entire file into one contiguous buffer, so that we can tokenize it without allocating anything per line.
+ * Compressed files are inflated straight into the buffer
+ */
+static std::vector<char> ReadObjFile(const char* filename) {
+	FileStream file(filename);
+
+	// If our file fails to open, we will throw an error
+	if (!file.IsOpen()) {
+		throw new std::runtime_error("Failed to open file");
+	}
+
+	LOG_TRACE("Loading mesh from '{}'", filename);
+
+	std::vector<char> buffer;
+	if (!file.ReadAll(buffer)) {
+		throw new std::runtime_error("Failed to read file");
+	}
+	return buffer;
+}
+
+/*
+ * Runs the loaded mesh through MeshOptimizer if the options ask for it
+ */
+static void OptimizeResult(MeshData& result, const ObjLoadOptions& options) {
+	if (options.Optimize) {
+		MeshOptimizeReport report = MeshOptimizer::Optimize(result);
+		LOG_TRACE("\tOptimized mesh, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", 
+			report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR);
+	}
+}
+
+/*
+ * Computes the tangents of the loaded mesh for normal mapping, if the options ask for them
+ */
+static void GenerateTangents(MeshData& result, const ObjLoadOptions& options) {
+	if (options.GenerateTangents) {
+		TangentOptions tangentOptions;
+		tangentOptions.Parallel = options.Parallel;
+		TangentGenerator::Generate(result, tangentOptions);
+	}
+}
+
+/*
+ * Finds the bounding sphere that LodGroup picks levels with, from the vertices of the full detail mesh
+ */
+static void ComputeBounds(const Vertex* vertices, size_t count, ObjMeshSource& result) {
+	if (count == 0)
+		return;
+	glm::vec3 min = vertices[0].Position, max = vertices[0].Position;
+	for (size_t ix = 1; ix < count; ix++) {
+		min = glm::min(min, vertices[ix].Position);
+		max = glm::max(max, vertices[ix].Position);
+	}
+	result.Center = (min + max) * 0.5f;
+	result.Radius = glm::length(max - min) * 0.5f;
+}
+
+/*
+ * Parses the contents of an OBJ file into mesh data
+ */
+static MeshData ParseObj(const std::vector<char>& buffer, const glm::vec4& baseColor, const ObjLoadOptions& options) {
+	// Determine how many pieces we should split the file into
+	ThreadPool& pool = ThreadPool::Global();
+	size_t numChunks = 1;
+	if (options.Parallel) {
+		size_t maxChunks = options.MaxChunks > 0 ? options.MaxChunks : (pool.GetThreadCount() + 1) * 4;
+		numChunks = std::max(std::min(maxChunks, buffer.size() / std::max(options.MinChunkBytes, (size_t)1)), (size_t)1);
+	}
+	std::vector<ObjChunk> chunks = SplitChunks(buffer.data(), buffer.data() + buffer.size(), numChunks);
+
+	// Parse all of our chunks
+	pool.ParallelFor(chunks.size(), [&](size_t ix) { ParseChunk(chunks[ix]); });
+
+	// Declare vectors for our combined positions, normals, and UVs
+	std::vector<glm::vec3>   positions;
+	std::vector<glm::vec2>   texUvs;
+	std::vector<glm::vec3>   normals;
+
+	// Work out where each chunk's data lands in the combined lists
+	size_t numPositions = 0, numUvs = 0, numNormals = 0, numFaces = 0;
+	for (ObjChunk& chunk : chunks) {
+		chunk.PositionOffset = numPositions; numPositions += chunk.Positions.size();
+		chunk.TexUvOffset    = numUvs;       numUvs       += chunk.TexUvs.size();
+		chunk.NormalOffset   = numNormals;   numNormals   += chunk.Normals.size();
+		chunk.FaceOffset     = numFaces;     numFaces     += chunk.Faces.size();
+	}
+
+	// With a single chunk we can just take its lists as is
+	if (chunks.size() == 1) {
+		positions = std::move(chunks[0].Positions);
+		texUvs    = std::move(chunks[0].TexUvs);
+		normals   = std::move(chunks[0].Normals);
+	}
+	// Otherwise we combine our attributes, and shift any relative indices to point into the combined lists
+	else {
+		positions.resize(numPositions);
+		texUvs.resize(numUvs);
+		normals.resize(numNormals);
+		pool.ParallelFor(chunks.size(), [&](size_t ix) {
+			ObjChunk& chunk = chunks[ix];
+			std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + chunk.PositionOffset);
+			std::copy(chunk.TexUvs.begin(),    chunk.TexUvs.end(),    texUvs.begin()    + chunk.TexUvOffset);
+			std::copy(chunk.Normals.begin(),   chunk.Normals.end(),   normals.begin()   + chunk.NormalOffset);
+			const size_t offsets[3] = { chunk.PositionOffset, chunk.TexUvOffset, chunk.NormalOffset };
+			for (size_t component : chunk.RelativeFixups) {
+				uint32_t* faceData = &chunk.Faces[component / 9][0][0];
+				faceData[component % 9] += static_cast<uint32_t>(offsets[component % 3]);
+			}
+			chunk.Positions = std::vector<glm::vec3>();
+			chunk.TexUvs    = std::vector<glm::vec2>();
+			chunk.Normals   = std::vector<glm::vec3>();
+		});
+	}
+
+	LOG_TRACE("\tLoaded data, starting post-processing");
 
+	// Every chunk can find its own unique vertices independently
+	pool.ParallelFor(chunks.size(), [&](size_t ix) { DeduplicateChunk(chunks[ix], positions, texUvs, normals, baseColor); });
+
+	// Create a result as a meshBuilder mesh data object
+	auto result = MeshData();
+
+	if (chunks.size() == 1) {
+		result.Vertices = std::move(chunks[0].Vertices);
+		result.Indices  = std::move(chunks[0].Indices);
+	}
+	else {
+		// Merge the chunk vertices in order, so that each vertex lands where a serial load would have put it
+		size_t maxVertices = 0;
+		for (const ObjChunk& chunk : chunks)
+			maxVertices += chunk.VertexKeys.size();
+		VertexHashTable vectorCache(maxVertices);
+		std::vector<std::vector<uint32_t>> remaps(chunks.size());
+		for (size_t ix = 0; ix < chunks.size(); ix++) {
+			ObjChunk& chunk = chunks[ix];
+			remaps[ix].resize(chunk.VertexKeys.size());
+			for (size_t jx = 0; jx < chunk.VertexKeys.size(); jx++) {
+				bool isNew = false;
+				remaps[ix][jx] = vectorCache.FindOrInsert(chunk.VertexKeys[jx], static_cast<uint32_t>(result.Vertices.size()), isNew);
+				if (isNew)
+					result.Vertices.push_back(chunk.Vertices[jx]);
 			}
 		}
+
+		// Now that we know where every vertex ended up, we can remap the indices
+		result.Indices.resize(numFaces * 3);
+		pool.ParallelFor(chunks.size(), [&](size_t ix) {
+			const ObjChunk& chunk = chunks[ix];
+			uint32_t* output = result.Indices.data() + chunk.FaceOffset * 3;
+			for (size_t jx = 0; jx < chunk.Indices.size(); jx++) {
+				output[jx] = remaps[ix][chunk.Indices[jx]];
+			}
+		});
 	}
 
+	OptimizeResult(result, options);
+
 	// Compute our TBN matrices for normal mapping
+	GenerateTangents(result, options);
 
-	// Create and return a result as a meshBuilder mesh data object
-	auto result = MeshData();
-	result.Vertices = vertices;
-	result.Indices  = indices;
+	return result;
+}
+
+// Returns true if an index in our index space is either not provided, or refers to an attribute we've already read
+static inline bool IsResolved(uint32_t index, size_t count) {
+	return index == (uint32_t)-1 || index < count;
+}
+
+/*
+ * Parses an OBJ file a window at a time, de-duplicating each face's vertices into the result as soon as it
+ * is read. Only the attribute lists, the vertex lookup table, one window of the file and the output are ever
+ * held in memory, instead of the whole file plus every face
+ * @param filename   The path to the file to load
+ * @param baseColor  The value to set for the vertex color attribute
+ * @param options    The settings to use for loading the file
+ * @param sourceHash Will store the hash of the file's contents, for the mesh cache
+ */
+static MeshData StreamObj(const char* filename, const glm::vec4& baseColor, const ObjLoadOptions& options, uint64_t& sourceHash) {
+	// Compressed files get inflated a window at a time as well, so they never exist in memory in full
+	FileStream file(filename);
+
+	// If our file fails to open, we will throw an error
+	if (!file.IsOpen()) {
+		throw new std::runtime_error("Failed to open file");
+	}
+
+	LOG_TRACE("Streaming mesh from '{}'", filename);
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texUvs;
+	std::vector<glm::vec3> normals;
+	VertexHashTable        vectorCache;
+	MeshData               result;
+
+	// Relative indices have already been resolved against everything we've read, which is all a streaming load
+	// can see, so we don't need to know which of them were relative
+	auto onFace = [&](const Face& face, const bool[3][3]) {
+		for (int jx = 0; jx < 3; jx++) {
+			bool isNew = false;
+			uint32_t index = vectorCache.FindOrInsert(face[jx], static_cast<uint32_t>(result.Vertices.size()), isNew);
+			if (isNew) {
+				// Unlike a full load, we can only see the attributes that came before the face
+				const glm::uvec3& aSet = face[jx];
+				bool resolved = IsResolved(aSet[0], positions.size()) && IsResolved(aSet[1], texUvs.size()) && IsResolved(aSet[2], normals.size());
+				if (aSet[2] == (uint32_t)-1)
+					resolved &= face[0][0] < positions.size() && face[1][0] < positions.size() && face[2][0] < positions.size();
+				if (!resolved) {
+					LOG_ERROR("Face in '{}' uses an attribute that is declared after it, which streaming loads do not support", filename);
+					throw new std::runtime_error("Face references an attribute that has not been read yet");
+				}
+				result.Vertices.push_back(MakeVertex(face, jx, positions, texUvs, normals, baseColor));
+			}
+			result.Indices.push_back(index);
+		}
+	};
+
+	std::vector<char> window(std::max(options.StreamWindowBytes, (size_t)4096));
+	// The number of bytes at the start of the window that are left over from the last read (a partial line)
+	size_t carry      = 0;
+	size_t totalBytes = 0;
+	size_t numWindows = 0;
+	size_t peakBytes  = 0;
+	sourceHash = MeshCache::HashSeed;
+
+	while (true) {
+		size_t read  = file.Read(window.data() + carry, window.size() - carry);
+		bool   atEnd = file.IsEnd();
+		if (file.HasError()) {
+			throw new std::runtime_error("Failed to read file");
+		}
+		sourceHash = MeshCache::HashBytes(window.data() + carry, read, sourceHash);
+		totalBytes += read;
+
+		const char* begin = window.data();
+		const char* end   = begin + carry + read;
+
+		// We can only parse up to the last full line, the rest gets carried over to the next window
+		const char* parseEnd = end;
+		if (!atEnd) {
+			while (parseEnd > begin && parseEnd[-1] != '\n')
+				parseEnd--;
+			// If a single line doesn't fit in the window, we grow the window until it does
+			if (parseEnd == begin) {
+				carry = window.size();
+				window.resize(window.size() * 2);
+				continue;
+			}
+		}
+
+		ParseLines(begin, parseEnd, positions, texUvs, normals, onFace);
+		numWindows++;
+
+		carry = end - parseEnd;
+		memmove(window.data(), parseEnd, carry);
+
+		// Tally up everything that we're holding on to, and bail out if we've gone over the budget
+		size_t usedBytes = 
+			window.capacity()           * sizeof(char) +
+			positions.capacity()        * sizeof(glm::vec3) +
+			texUvs.capacity()           * sizeof(glm::vec2) +
+			normals.capacity()          * sizeof(glm::vec3) +
+			result.Vertices.capacity()  * sizeof(Vertex) +
+			result.Indices.capacity()   * sizeof(uint32_t) +
+			vectorCache.GetSizeBytes();
+		peakBytes = std::max(peakBytes, usedBytes);
+		if (options.StreamBudgetBytes > 0 && usedBytes > options.StreamBudgetBytes) {
+			LOG_ERROR("Streaming '{}' needs more than its budget of {:.1f} MB (using {:.1f} MB after {:.1f} MB of the file)", 
+				filename, options.StreamBudgetBytes / (1024.0 * 1024.0), usedBytes / (1024.0 * 1024.0), totalBytes / (1024.0 * 1024.0));
+			throw new std::runtime_error("OBJ file does not fit in the streaming memory budget");
+		}
+
+		if (atEnd)
+			break;
+	}
+
+	LOG_TRACE("\tStreamed {:.1f} MB in {} windows, loader used at most {:.1f} MB", 
+		totalBytes / (1024.0 * 1024.0), numWindows, peakBytes / (1024.0 * 1024.0));
+	LOG_TRACE("\tProcess memory {:.1f} MB, peak {:.1f} MB", System::GetMemoryUsageMB(), System::GetPeakMemoryUsageMB());
+
+	OptimizeResult(result, options);
+	GenerateTangents(result, options);
+	return result;
+}
+
+MeshData ObjLoader::LoadObj(const char* filename, glm::vec4 baseColor, const ObjLoadOptions& options) {
+	if (options.Streaming) {
+		uint64_t sourceHash = 0;
+		return StreamObj(filename, baseColor, options, sourceHash);
+	}
+	return ParseObj(ReadObjFile(filename), baseColor, options);
+}
+
+Mesh::Sptr ObjLoader::LoadObjToMesh(const char* filename, glm::vec4 baseColor, const ObjLoadOptions& options) {
+	return CreateMesh(LoadObjSource(filename, baseColor, options));
+}
+
+ObjMeshSource ObjLoader::LoadObjSource(const char* filename, glm::vec4 baseColor, const ObjLoadOptions& options) {
+	ObjMeshSource result;
+	result.IsPacked = options.PackVertices;
+
+	// If we have an up to date cache, we can hand the mapped data straight to OpenGL
+	uint32_t flags = 
+		(options.Optimize         ? MeshCache::FlagOptimized : 0) |
+		(options.GenerateTangents ? MeshCache::FlagTangents  : 0);
+	// The LOD levels are part of the cache, so they need to have been built with the same settings
+	uint64_t lodKey = options.BuildLods ? MeshCache::HashLodOptions(options.Lods) : 0;
+	if (options.UseCache && MeshCache::TryLoad(filename, baseColor, flags, lodKey, result.Cached)) {
+		LOG_TRACE("Loaded mesh from cache '{}' ({} LOD levels)", MeshCache::GetCachePath(filename), result.Cached.Lods.size());
+		if (options.PackVertices) {
+			result.PackedVertices.resize(result.Cached.VertexCount);
+			for (size_t ix = 0; ix < result.Cached.VertexCount; ix++)
+				result.PackedVertices[ix] = PackedVertex::Pack(result.Cached.Vertices[ix]);
+			for (const MappedLodLevel& level : result.Cached.Lods) {
+				result.PackedLodVertices.emplace_back(level.VertexCount);
+				for (size_t ix = 0; ix < level.VertexCount; ix++)
+					result.PackedLodVertices.back()[ix] = PackedVertex::Pack(level.Vertices[ix]);
+			}
+		}
+		if (options.BuildLods)
+			ComputeBounds(result.Cached.Vertices, result.Cached.VertexCount, result);
+		return result;
+	}
+
+	uint64_t sourceHash = 0;
+	if (options.Streaming) {
+		result.Data = StreamObj(filename, baseColor, options, sourceHash);
+	}
+	else {
+		std::vector<char> buffer = ReadObjFile(filename);
+		result.Data = ParseObj(buffer, baseColor, options);
+		sourceHash = MeshCache::HashBytes(buffer.data(), buffer.size());
+	}
+
+	if (options.BuildLods) {
+		// The first level of the chain is just a copy of our mesh, so we only hang on to the ones after it
+		std::vector<MeshLodLevel> chain = MeshSimplifier::BuildLodChain(result.Data, options.Lods);
+		result.Lods.assign(std::make_move_iterator(chain.begin() + 1), std::make_move_iterator(chain.end()));
+		ComputeBounds(result.Data.Vertices.data(), result.Data.Vertices.size(), result);
+		LOG_TRACE("\tBuilt {} LOD levels", result.Lods.size());
+	}
+
+	if (options.UseCache) {
+		MeshCache::Write(filename, sourceHash, baseColor, flags, lodKey, result.Data, result.Lods);
+	}
+
+	if (options.PackVertices) {
+		result.PackedVertices = PackedVertex::Pack(result.Data.Vertices);
+		for (const MeshLodLevel& level : result.Lods)
+			result.PackedLodVertices.push_back(PackedVertex::Pack(level.Data.Vertices));
+	}
+	return result;
+}
+
+Mesh::Sptr ObjLoader::CreateMesh(const ObjMeshSource& source) {
+	// Our indices come from the cache mapping if we have one, otherwise from the parsed data
+	const uint32_t* indices = source.Cached.File != nullptr ? source.Cached.Indices : source.Data.Indices.data();
+	size_t indexCount = source.Cached.File != nullptr ? source.Cached.IndexCount : source.Data.Indices.size();
+
+	if (source.IsPacked) {
+		return std::make_shared<Mesh>(source.PackedVertices.data(), source.PackedVertices.size(), indices, indexCount);
+	}
+	if (source.Cached.File != nullptr) {
+		return std::make_shared<Mesh>(source.Cached.Vertices, source.Cached.VertexCount, indices, indexCount);
+	}
+	return std::make_shared<Mesh>(source.Data.Vertices.data(), source.Data.Vertices.size(), indices, indexCount);
+}
+
+LodGroup ObjLoader::CreateLodGroup(const ObjMeshSource& source) {
+	LodGroup result;
+	result.Center = source.Center;
+	result.Radius = source.Radius;
+	result.Levels.push_back({ CreateMesh(source), 0.0f });
+
+	// Like the full mesh, our levels come from the cache mapping if we have one, otherwise from the parsed data
+	bool isCached = source.Cached.File != nullptr;
+	size_t levelCount = isCached ? source.Cached.Lods.size() : source.Lods.size();
+	for (size_t ix = 0; ix < levelCount; ix++) {
+		const uint32_t* indices    = isCached ? source.Cached.Lods[ix].Indices : source.Lods[ix].Data.Indices.data();
+		size_t          indexCount = isCached ? source.Cached.Lods[ix].IndexCount : source.Lods[ix].Data.Indices.size();
+		float           error      = isCached ? source.Cached.Lods[ix].Error : source.Lods[ix].Error;
+
+		Mesh::Sptr mesh;
+		if (source.IsPacked) {
+			const std::vector<PackedVertex>& vertices = source.PackedLodVertices[ix];
+			mesh = std::make_shared<Mesh>(vertices.data(), vertices.size(), indices, indexCount);
+		}
+		else if (isCached) {
+			mesh = std::make_shared<Mesh>(source.Cached.Lods[ix].Vertices, source.Cached.Lods[ix].VertexCount, indices, indexCount);
+		}
+		else {
+			mesh = std::make_shared<Mesh>(source.Lods[ix].Data.Vertices.data(), source.Lods[ix].Data.Vertices.size(), indices, indexCount);
+		}
+		result.Levels.push_back({ mesh, error });
+	}
 	return result;
 }
@@ -6,20 +6,107 @@
 #pragma once
 
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "LodGroup.h"
 #include <vector>
 
 /*
- * Helper structure to store the data required to create a mesh
+ * Settings for how an OBJ file should be loaded
  */
-struct MeshData {
+struct ObjLoadOptions {
 	/*
-	 * The vertex data for the mesh
+	 * True if the file should be split into chunks and parsed on the global thread pool. The result is
+	 * identical to a serial load, files smaller than MinChunkBytes will always be loaded serially
 	 */
-	std::vector<Vertex>   Vertices;
+	bool   Parallel      = true;
 	/*
-	 * The index data for the mesh
+	 * The maximum number of chunks to split the file into, 0 will use 4 chunks per hardware thread
 	 */
-	std::vector<uint32_t> Indices;
+	size_t MaxChunks     = 0;
+	/*
+	 * The smallest chunk size (in bytes) that we will split the file into
+	 */
+	size_t MinChunkBytes = 1024 * 1024;
+	/*
+	 * True if LoadObjToMesh should use (and write) a binary .smesh cache next to the source file
+	 */
+	bool   UseCache      = true;
+	/*
+	 * True if the mesh should be run through MeshOptimizer after loading, to reorder its triangles and vertices
+	 * for the GPU's vertex cache. This changes the order that triangles are drawn in, so meshes drawn with
+	 * blending may look different. Opaque meshes look the same
+	 */
+	bool   Optimize      = false;
+	/*
+	 * True if tangents should be generated for the mesh (see TangentGenerator), which normal mapping needs.
+	 * Only turn this on for meshes drawn with a normal mapped material. Meshes without UVs still get tangents,
+	 * they just won't line up with anything
+	 */
+	bool   GenerateTangents = false;
+	/*
+	 * True if LoadObjToMesh should create the mesh with PackedVertex, which uses less than half the memory
+	 * at the cost of half float precision for positions and UVs
+	 */
+	bool   PackVertices  = false;
+	/*
+	 * True if LoadObjSource should build a LOD chain for the mesh (see MeshSimplifier::BuildLodChain). The levels
+	 * are stored in the .smesh cache along with the mesh, so they are only built again if Lods changes
+	 */
+	bool   BuildLods     = false;
+	/*
+	 * The settings for the LOD chain, if BuildLods is set
+	 */
+	LodChainOptions Lods;
+	/*
+	 * True if the file should be read a window at a time, turning faces into vertices as they are read instead
+	 * of holding the entire file and all of its faces in memory. This is slower than a parallel load, but keeps
+	 * memory use close to the size of the output, which matters for very large scans. Faces may only use
+	 * attributes that are declared before them (which every exporter we know of does)
+	 */
+	bool   Streaming         = false;
+	/*
+	 * The number of bytes of the file that the streaming loader reads at a time
+	 */
+	size_t StreamWindowBytes = 4 * 1024 * 1024;
+	/*
+	 * The most memory (in bytes) that the streaming loader may hold on to, including its output. Loading fails
+	 * with an exception if the file needs more than this, 0 for no limit
+	 */
+	size_t StreamBudgetBytes = 0;
+};
+
+/*
+ * The CPU side data for an OBJ mesh, which can be loaded on any thread and then turned into a Mesh on the
+ * OpenGL thread with ObjLoader::CreateMesh
+ */
+struct ObjMeshSource {
+	/*
+	 * The mapped cache data, filled in if the mesh was loaded from its .smesh cache
+	 */
+	MappedMeshData            Cached;
+	/*
+	 * The parsed mesh data, filled in if the mesh was loaded from the OBJ file
+	 */
+	MeshData                  Data;
+	/*
+	 * The packed vertices, filled in if the mesh should use PackedVertex
+	 */
+	std::vector<PackedVertex> PackedVertices;
+	bool                      IsPacked = false;
+	/*
+	 * The levels of the LOD chain after the full detail mesh, filled in if the LODs were built instead of
+	 * loaded from the cache (the cached levels are in Cached.Lods)
+	 */
+	std::vector<MeshLodLevel> Lods;
+	/*
+	 * The packed vertices for each LOD level, filled in if the mesh should use PackedVertex
+	 */
+	std::vector<std::vector<PackedVertex>> PackedLodVertices;
+	/*
+	 * The bounding sphere of the mesh, filled in if the LODs were requested
+	 */
+	glm::vec3                 Center = glm::vec3(0.0f);
+	float                     Radius = 0.0f;
 };
 
 class ObjLoader {
@@ -28,17 +115,36 @@ public:
 	 * Loads a mesh from an obj file at the given file name
 	 * @param filename  The path to the file to load
 	 * @param baseColor The value to set for the vertex color attribute (default white)
+	 * @param options   The settings to use for loading the file
 	 * @returns The mesh data loaded from the OBJ file
 	 */
-	static MeshData LoadObj(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f));
+	static MeshData LoadObj(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f), const ObjLoadOptions& options = ObjLoadOptions());
 	/*
-	 * Loads a mesh from an obj file, and immediately creates an OpenGL mesh from it
+	 * Loads a mesh from an obj file, and immediately creates an OpenGL mesh from it. If enabled in the options,
+	 * the mesh will be loaded from the file's .smesh cache when it is up to date, and the cache will be written
+	 * after parsing otherwise
 	 * @param filename  The path to the file to load
 	 * @param baseColor The value to set for the vertex color attribute (default white)
+	 * @param options   The settings to use for loading the file
 	 * @returns A mesh that has been created from the data loaded from the OBJ file
 	 */
-	static Mesh::Sptr LoadObjToMesh(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f)) {
-		MeshData data = LoadObj(filename, baseColor);
-		return std::make_shared<Mesh>(data.Vertices.data(), data.Vertices.size(), data.Indices.data(), data.Indices.size());
-	}
+	static Mesh::Sptr LoadObjToMesh(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f), const ObjLoadOptions& options = ObjLoadOptions());
+	/*
+	 * Does all of the CPU work of LoadObjToMesh (reading the cache or parsing, writing the cache and packing),
+	 * without touching OpenGL, so that it is safe to call from a worker thread
+	 * @param filename  The path to the file to load
+	 * @param baseColor The value to set for the vertex color attribute (default white)
+	 * @param options   The settings to use for loading the file
+	 * @returns The data needed to create the mesh
+	 */
+	static ObjMeshSource LoadObjSource(const char* filename, glm::vec4 baseColor = glm::vec4(1.0f), const ObjLoadOptions& options = ObjLoadOptions());
+	/*
+	 * Creates an OpenGL mesh from data loaded with LoadObjSource, this must be called on the OpenGL thread
+	 */
+	static Mesh::Sptr CreateMesh(const ObjMeshSource& source);
+	/*
+	 * Creates the meshes for every level of a LOD chain loaded with LoadObjSource (with BuildLods set), this
+	 * must be called on the OpenGL thread. The first level is the same mesh CreateMesh would make
+	 */
+	static LodGroup CreateLodGroup(const ObjMeshSource& source);
 };
@@ -0,0 +1,175 @@
+#include "ResourceCache.h"
+#include "Logging.h"
+
+#include <chrono>
+
+// Makes a future that already holds the given value
+template <typename T>
+static std::shared_future<T> MakeReadyFuture(const T& value) {
+	std::promise<T> promise;
+	promise.set_value(value);
+	return promise.get_future().share();
+}
+
+// Gets the number of bytes per pixel that the GPU will use for one of our formats
+static size_t GetBytesPerPixel(InternalFormat format) {
+	switch (format) {
+		case InternalFormat::R8:     return 1;
+		case InternalFormat::R16:    return 2;
+		case InternalFormat::RGB8:   return 3;
+		case InternalFormat::RGBA8:  return 4;
+		case InternalFormat::RGB16:  return 6;
+		case InternalFormat::RGBA16: return 8;
+		default:                     return 4;
+	}
+}
+
+ResourceCache::ResourceCache(const AssetLoader::Sptr& loader) :
+	myLoader(loader)
+{ }
+
+template <typename T>
+std::shared_future<std::shared_ptr<T>> ResourceCache::__Get(CacheMap<T>& entries, const std::string& key,
+	const std::function<void(const std::shared_ptr<T>&)>& onLoaded, const LoadFunc<T>& load)
+{
+	auto it = entries.find(key);
+	if (it != entries.end()) {
+		CacheEntry<T>& entry = it->second;
+		// If the load is still in flight, we just wait for it along with everyone else. A finished load that
+		// is still marked as loading failed (loaders don't call back with failures), so we'll try again
+		if (entry.IsLoading && entry.Loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			myStats.Hits++;
+			entry.PendingHits++;
+			if (onLoaded)
+				entry.Waiting.push_back(onLoaded);
+			return entry.Loading;
+		}
+		if (std::shared_ptr<T> resource = entry.Resource.lock()) {
+			myStats.Hits++;
+			myStats.BytesSaved += __GetSizeBytes(*resource);
+			if (onLoaded)
+				onLoaded(resource);
+			return MakeReadyFuture(resource);
+		}
+	}
+
+	// Either we've never seen this resource, or everyone let go of it and it was unloaded
+	myStats.Misses++;
+	__Prune(entries);
+	CacheEntry<T>& entry = entries[key];
+	entry = CacheEntry<T>();
+	entry.IsLoading = true;
+	if (onLoaded)
+		entry.Waiting.push_back(onLoaded);
+
+	std::shared_future<std::shared_ptr<T>> result = load([this, &entries, key](const std::shared_ptr<T>& resource) {
+		auto it = entries.find(key);
+		if (it == entries.end())
+			return;
+		CacheEntry<T>& entry = it->second;
+		entry.Resource  = resource;
+		// Drop our future, since it holds a strong reference that would keep the resource loaded forever
+		entry.Loading   = std::shared_future<std::shared_ptr<T>>();
+		entry.IsLoading = false;
+		myStats.BytesSaved += entry.PendingHits * __GetSizeBytes(*resource);
+		entry.PendingHits = 0;
+
+		std::vector<typename CacheEntry<T>::Callback> waiting = std::move(entry.Waiting);
+		entry.Waiting.clear();
+		for (auto& callback : waiting)
+			callback(resource);
+	});
+
+	// Some loads (like shaders) finish right away, in which case we must not hang on to the future
+	it = entries.find(key);
+	if (it != entries.end() && it->second.IsLoading)
+		it->second.Loading = result;
+	return result;
+}
+
+template <typename T>
+void ResourceCache::__Prune(CacheMap<T>& entries) {
+	for (auto it = entries.begin(); it != entries.end(); ) {
+		if (!it->second.IsLoading && it->second.Resource.expired())
+			it = entries.erase(it);
+		else
+			it++;
+	}
+}
+
+std::shared_future<Texture2D::Sptr> ResourceCache::LoadTexture(const std::string& fileName, const TextureLoadOptions& options,
+	std::function<void(const Texture2D::Sptr&)> onLoaded)
+{
+	std::string key = fileName + "|alpha=" + std::to_string(options.LoadAlpha) + "|flip=" + std::to_string(options.FlipVertically);
+	AssetLoader::Sptr loader = myLoader;
+	return __Get<Texture2D>(myTextures, key, onLoaded, [=](std::function<void(const Texture2D::Sptr&)> done) {
+		return loader->LoadTexture(fileName, options, done);
+	});
+}
+
+std::shared_future<TextureCube::Sptr> ResourceCache::LoadTextureCube(const std::string faceFiles[6], bool flipVertically,
+	std::function<void(const TextureCube::Sptr&)> onLoaded)
+{
+	std::string key = "|flip=" + std::to_string(flipVertically);
+	for (int ix = 0; ix < 6; ix++)
+		key = faceFiles[ix] + ";" + key;
+	std::vector<std::string> files(faceFiles, faceFiles + 6);
+	AssetLoader::Sptr loader = myLoader;
+	return __Get<TextureCube>(myCubeMaps, key, onLoaded, [=](std::function<void(const TextureCube::Sptr&)> done) {
+		return loader->LoadTextureCube(files.data(), flipVertically, done);
+	});
+}
+
+std::shared_future<Mesh::Sptr> ResourceCache::LoadMesh(const std::string& fileName, const glm::vec4& baseColor, const ObjLoadOptions& options,
+	std::function<void(const Mesh::Sptr&)> onLoaded)
+{
+	// Only the options that change the resulting mesh are part of the key
+	std::string key = fileName +
+		"|color=" + std::to_string(baseColor.r) + "," + std::to_string(baseColor.g) + "," + std::to_string(baseColor.b) + "," + std::to_string(baseColor.a) +
+		"|optimize=" + std::to_string(options.Optimize) + "|packed=" + std::to_string(options.PackVertices) +
+		"|tangents=" + std::to_string(options.GenerateTangents);
+	AssetLoader::Sptr loader = myLoader;
+	return __Get<Mesh>(myMeshes, key, onLoaded, [=](std::function<void(const Mesh::Sptr&)> done) {
+		return loader->LoadMesh(fileName, baseColor, options, done);
+	});
+}
+
+Shader::Sptr ResourceCache::LoadShader(const std::string& vsFile, const std::string& fsFile, const ShaderDefines& defines) {
+	std::string key = vsFile + "|" + fsFile + "|" + ShaderPreprocessor::GetDefinesKey(defines);
+	try {
+		return __Get<Shader>(myShaders, key, nullptr, [=](std::function<void(const Shader::Sptr&)> done) {
+			Shader::Sptr result = std::make_shared<Shader>();
+			result->DebugName = vsFile + " + " + fsFile;
+			result->LoadAsync(vsFile.c_str(), fsFile.c_str(), defines);
+			done(result);
+			return MakeReadyFuture(result);
+		}).get();
+	}
+	catch (...) {
+		// The load threw before it could finish (ex: a missing include), so the entry would be stuck loading with
+		// nothing to wait on. We drop it, so that the next request for this shader tries again
+		myShaders.erase(key);
+		throw;
+	}
+}
+
+size_t ResourceCache::__GetSizeBytes(const Texture2D& texture) {
+	const Texture2DDescription& desc = texture.GetDescription();
+	size_t size = static_cast<size_t>(desc.Width) * desc.Height * GetBytesPerPixel(desc.Format);
+	// A full mip chain adds another third on top of the base level
+	return desc.EnableMip ? size * 4 / 3 : size;
+}
+
+size_t ResourceCache::__GetSizeBytes(const TextureCube& texture) {
+	const TextureCubeDesc& desc = texture.GetDescription();
+	return static_cast<size_t>(desc.Size) * desc.Size * 6 * GetBytesPerPixel(desc.Format);
+}
+
+size_t ResourceCache::__GetSizeBytes(const Mesh& mesh) {
+	return mesh.GetSizeBytes();
+}
+
+size_t ResourceCache::__GetSizeBytes(const Shader&) {
+	// Shader programs live in driver memory, not in VRAM that we're tracking
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+	Makes sure that we only ever load one copy of each resource. Resources are keyed by their path and the
+	options they were loaded with, and handed out as shared pointers. The cache only holds weak references,
+	so a resource gets unloaded as soon as nothing else is using it
+
+	Textures and meshes are loaded in the background through an AssetLoader, requests for a resource that is
+	still loading will share the same load
+*/
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "Shader.h"
+#include "Utils.h"
+
+/*
+ * Statistics for how well the resource cache is doing
+ */
+struct ResourceCacheStats {
+	// The number of requests that were served by an existing (or loading) resource
+	size_t Hits       = 0;
+	// The number of requests that had to load a new resource
+	size_t Misses     = 0;
+	// The number of bytes of GPU memory that we would have used for duplicate copies without the cache
+	size_t BytesSaved = 0;
+};
+
+class ResourceCache {
+public:
+	typedef std::shared_ptr<ResourceCache> Sptr;
+	NoCopy(ResourceCache);
+	NoMove(ResourceCache);
+
+	/*
+	 * Creates a new resource cache
+	 * @param loader The asset loader to load textures and meshes with
+	 */
+	ResourceCache(const AssetLoader::Sptr& loader);
+	~ResourceCache() = default;
+
+	/*
+	 * Gets a texture, loading it if there isn't a copy with the same options already
+	 * @param fileName The path of the image to load
+	 * @param options  How the image should be decoded
+	 * @param onLoaded Optional, invoked on the main thread with the texture once it is ready
+	 * @returns A future that will hold the texture (or nullptr if the image could not be loaded)
+	 */
+	std::shared_future<Texture2D::Sptr> LoadTexture(const std::string& fileName, const TextureLoadOptions& options = TextureLoadOptions(),
+		std::function<void(const Texture2D::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Gets a cube map, loading it if there isn't a copy of the same faces already
+	 * @param faceFiles      The paths of the images for each face, in the order of CubeMapFace
+	 * @param flipVertically True if the rows of each face should be flipped
+	 * @param onLoaded       Optional, invoked on the main thread with the cube map once it is ready
+	 * @returns A future that will hold the cube map (or nullptr if the images could not be loaded)
+	 */
+	std::shared_future<TextureCube::Sptr> LoadTextureCube(const std::string faceFiles[6], bool flipVertically = true,
+		std::function<void(const TextureCube::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Gets a mesh from an OBJ file, loading it if there isn't a copy with the same color and options already
+	 * @param fileName  The path of the OBJ file to load
+	 * @param baseColor The value to set for the vertex color attribute
+	 * @param options   The settings to use for loading the file
+	 * @param onLoaded  Optional, invoked on the main thread with the mesh once it is ready
+	 * @returns A future that will hold the mesh
+	 */
+	std::shared_future<Mesh::Sptr> LoadMesh(const std::string& fileName, const glm::vec4& baseColor = glm::vec4(1.0f),
+		const ObjLoadOptions& options = ObjLoadOptions(), std::function<void(const Mesh::Sptr&)> onLoaded = nullptr);
+
+	/*
+	 * Gets a shader program, compiling it if the same pair of files hasn't been loaded already with the same
+	 * defines. Each set of defines is its own variant of the shader. The files are read right away on the calling
+	 * thread, but the program is built in the background by the driver (see Shader::LoadAsync)
+	 * @param vsFile  The path of the vertex shader
+	 * @param fsFile  The path of the fragment shader
+	 * @param defines The #defines to compile the variant with (see ShaderPreprocessor)
+	 * @returns The shader program, which can't be drawn with until Shader::IsReady returns true. Throws a
+	 *          std::runtime_error* if the files could not be read
+	 */
+	Shader::Sptr LoadShader(const std::string& vsFile, const std::string& fsFile, const ShaderDefines& defines = ShaderDefines());
+
+	// Gets the hit/miss statistics for the cache
+	const ResourceCacheStats& GetStats() const { return myStats; }
+
+private:
+	template <typename T>
+	struct CacheEntry {
+		typedef std::function<void(const std::shared_ptr<T>&)> Callback;
+
+		// The resource, once it has finished loading
+		std::weak_ptr<T>                       Resource;
+		// The load that is in flight, this is reset once the load finishes so that we don't keep the resource alive
+		std::shared_future<std::shared_ptr<T>> Loading;
+		bool                                   IsLoading   = false;
+		// Callbacks from requests that came in while we were loading
+		std::vector<Callback>                  Waiting;
+		// The number of requests that came in while we were loading
+		size_t                                 PendingHits = 0;
+	};
+
+	template <typename T>
+	using CacheMap = std::unordered_map<std::string, CacheEntry<T>>;
+
+	template <typename T>
+	using LoadFunc = std::function<std::shared_future<std::shared_ptr<T>>(std::function<void(const std::shared_ptr<T>&)>)>;
+
+	AssetLoader::Sptr              myLoader;
+	ResourceCacheStats             myStats;
+	CacheMap<Texture2D>            myTextures;
+	CacheMap<TextureCube>          myCubeMaps;
+	CacheMap<Mesh>                 myMeshes;
+	CacheMap<Shader>               myShaders;
+
+	template <typename T>
+	std::shared_future<std::shared_ptr<T>> __Get(CacheMap<T>& entries, const std::string& key,
+		const std::function<void(const std::shared_ptr<T>&)>& onLoaded, const LoadFunc<T>& load);
+
+	// Removes the entries for resources that have been unloaded
+	template <typename T>
+	static void __Prune(CacheMap<T>& entries);
+
+	// Estimates how much GPU memory a resource is using
+	static size_t __GetSizeBytes(const Texture2D& texture);
+	static size_t __GetSizeBytes(const TextureCube& texture);
+	static size_t __GetSizeBytes(const Mesh& mesh);
+	static size_t __GetSizeBytes(const Shader& shader);
+};
@@ -0,0 +1,43 @@
+#include "SceneUniforms.h"
+
+#include <algorithm>
+
+SceneUniforms::SceneUniforms(size_t viewsPerFrame) :
+	myViewSlots(std::max(viewsPerFrame, (size_t)1)),
+	myNextView(0)
+{
+	// Each slot we bind has to start on a multiple of the driver's alignment
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, 1);
+	myViewStride = (sizeof(ViewUniforms) + alignment - 1) / alignment * alignment;
+
+	glCreateBuffers(2, myBuffers);
+	glNamedBufferData(myBuffers[0], sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+	glNamedBufferData(myBuffers[1], myViewStride * myViewSlots, nullptr, GL_DYNAMIC_DRAW);
+}
+
+SceneUniforms::~SceneUniforms() {
+	glDeleteBuffers(2, myBuffers);
+}
+
+void SceneUniforms::BeginFrame(float time, float deltaTime) {
+	FrameUniforms frame = { time, deltaTime, { 0.0f, 0.0f } };
+	glNamedBufferSubData(myBuffers[0], 0, sizeof(FrameUniforms), &frame);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FrameBinding, myBuffers[0]);
+	myNextView = 0;
+}
+
+void SceneUniforms::SetView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+	ViewUniforms data;
+	data.View           = view;
+	data.Projection     = projection;
+	data.ViewProjection = projection * view;
+	data.CameraPos      = glm::vec4(cameraPos, 1.0f);
+
+	// If we run out of slots we go back to the first one, which is still correct but the driver may have to wait
+	GLintptr offset = static_cast<GLintptr>(myNextView % myViewSlots) * myViewStride;
+	myNextView++;
+	glNamedBufferSubData(myBuffers[1], offset, sizeof(ViewUniforms), &data);
+	glBindBufferRange(GL_UNIFORM_BUFFER, ViewBinding, myBuffers[1], offset, sizeof(ViewUniforms));
+}
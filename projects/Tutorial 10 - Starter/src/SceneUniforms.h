@@ -0,0 +1,68 @@
+/*
+	The uniform blocks that every shader shares, so that values which are the same for a whole frame, or for a whole
+	viewport, get uploaded once instead of being set on each shader that we bind:
+
+		layout(std140, binding = 0) uniform FrameData { float a_Time; float a_DeltaTime; };
+		layout(std140, binding = 1) uniform ViewData  { mat4 a_View; mat4 a_Projection; mat4 a_ViewProjection; vec3 a_CameraPos; };
+
+	Each view in a frame gets its own slot in the view buffer, so that updating the view for one viewport never has
+	to wait on the GPU to finish drawing the last one
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include "Utils.h"
+
+/*
+ * The FrameData block, laid out to match std140
+ */
+struct FrameUniforms {
+	float Time;
+	float DeltaTime;
+	float Padding[2];
+};
+
+/*
+ * The ViewData block, laid out to match std140 (a vec3 takes up the space of a vec4)
+ */
+struct ViewUniforms {
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::vec4 CameraPos;
+};
+
+class SceneUniforms {
+public:
+	GraphicsClass(SceneUniforms);
+
+	/*
+	 * Creates the shared uniform buffers
+	 * @param viewsPerFrame The number of views we expect to draw each frame, views past this share slots
+	 */
+	SceneUniforms(size_t viewsPerFrame = 8);
+	~SceneUniforms();
+
+	/*
+	 * Uploads and binds the frame block, and starts handing out view slots from the beginning again. This should be
+	 * called at the start of each frame
+	 */
+	void BeginFrame(float time, float deltaTime);
+	/*
+	 * Uploads a view into the next slot, and binds that slot as the view block for everything drawn after this
+	 */
+	void SetView(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+
+	// The binding points of the FrameData and ViewData blocks in our shaders
+	static constexpr GLuint FrameBinding = 0;
+	static constexpr GLuint ViewBinding  = 1;
+
+private:
+	// 0 is the frame block, 1 is the view slots
+	GLuint     myBuffers[2];
+	// The distance between view slots, which is the size of a view rounded up to the driver's alignment
+	GLsizeiptr myViewStride;
+	size_t     myViewSlots;
+	size_t     myNextView;
+};
@@ -1,155 +1,371 @@
 #include "Shader.h"
 #include "Logging.h"
+#include "ShaderCache.h"
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
-
-// Reads the entire contents of a file
-char* readFile(const char* filename) {
-	// Declare and open the file stream
-	std::ifstream file;
-	file.open(filename, std::ios::binary);
-
-	// Only read if the file is open
-	if (file.is_open()) {
-		// Get the starting location in the file
-		uint64_t fileSize = file.tellg();
-		// Seek to the end
-		file.seekg(0, std::ios::end);
-		// Calculate the file size from end to beginning
-		fileSize = (uint64_t)file.tellg() - fileSize;
-		// Seek back to the beginning of the file
-		file.seekg(0, std::ios::beg);
-
-		// Allocate space for our entire file, +1 byte at the end for null terminator
-		char* result = new char[fileSize + 1];
-		// Read the entire file to our memory
-		file.read(result, fileSize);
-
-		// Make our text null-terminated
-		result[fileSize] = '\0';
-
-		// Close the file before returning
-		file.close();
-		return result;
-
-	}
-	// Otherwise, we failed to open our file, throw a runtime error
-	else {
-		throw std::runtime_error("We cannot open the file!");
-	}
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+ShaderUniformStats Shader::_FrameStats;
+bool Shader::_ParallelCompile = false;
+std::vector<Shader*> Shader::_Pending;
+
+// From KHR_parallel_shader_compile, ARB_parallel_shader_compile uses the same values. Our glad wasn't generated with
+// either of them, so we load what we need ourselves
+static constexpr GLenum CompletionStatus = 0x91B1;
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+// Maps every uniform name we've seen to its ID. This is a function static so that it exists before any other
+// static wants an ID
+static std::unordered_map<std::string, Shader::UniformId>& UniformIds() {
+	static std::unordered_map<std::string, Shader::UniformId> ids;
+	return ids;
 }
 
+Shader::UniformId Shader::GetUniformId(const std::string& name) {
+	std::unordered_map<std::string, UniformId>& ids = UniformIds();
+	// The first element of an array is the same uniform as the array itself
+	if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		return GetUniformId(name.substr(0, name.size() - 3));
+	auto it = ids.find(name);
+	if (it != ids.end())
+		return it->second;
+	UniformId id = static_cast<UniformId>(ids.size());
+	ids[name] = id;
+	return id;
+}
 
 Shader::Shader() {
 	myShaderHandle = glCreateProgram();
+	mySupportsBatching = false;
+	myIsReady = false;
+	myParts[0] = myParts[1] = 0;
+	myCacheKey = 0;
 }
 
 Shader::~Shader() {
+	auto it = std::find(_Pending.begin(), _Pending.end(), this);
+	if (it != _Pending.end())
+		_Pending.erase(it);
+	for (GLuint part : myParts) {
+		if (part != 0)
+			glDeleteShader(part);
+	}
 	glDeleteProgram(myShaderHandle);
 }
 
 void Shader::Compile(const char* vs_source, const char* fs_source) {
-	// Compile our two shader programs
-	GLuint vs = __CompileShaderPart(vs_source, GL_VERTEX_SHADER);
-	GLuint fs = __CompileShaderPart(fs_source, GL_FRAGMENT_SHADER);
+	__BeginCompile(vs_source, fs_source);
+	__FinishCompile();
+}
+
+void Shader::CompileAsync(const char* vs_source, const char* fs_source) {
+	__BeginCompile(vs_source, fs_source);
+	// Programs from the cache are already linked, so there's nothing to wait on
+	if (myParts[0] == 0)
+		__FinishCompile();
+	else
+		_Pending.push_back(this);
+}
+
+void Shader::InitParallelCompile(GLADloadproc loader) {
+	_ParallelCompile = false;
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint ix = 0; ix < count && !_ParallelCompile; ix++) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, ix));
+		const char* proc = nullptr;
+		if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+			proc = "glMaxShaderCompilerThreadsKHR";
+		else if (strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+			proc = "glMaxShaderCompilerThreadsARB";
+		if (proc == nullptr)
+			continue;
+		_ParallelCompile = true;
+		// Let the driver use as many threads as it wants
+		MaxShaderCompilerThreadsProc maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(loader(proc));
+		if (maxThreads != nullptr)
+			maxThreads(0xFFFFFFFF);
+	}
+	if (_ParallelCompile)
+		LOG_INFO("Shaders will be compiled in parallel by the driver");
+	else
+		LOG_INFO("Parallel shader compiles are not supported, shaders will be finished one at a time");
+}
+
+size_t Shader::ProcessPending(double budgetMs) {
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t finished = 0;
+	for (size_t ix = 0; ix < _Pending.size(); ) {
+		Shader* shader = _Pending[ix];
+		// Without the extension, finishing a shader waits for the driver, so we stop once we're out of time (always
+		// finishing at least one, so that loading keeps moving)
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (!shader->__IsLinkComplete() || (finished > 0 && elapsedMs >= budgetMs)) {
+			ix++;
+			continue;
+		}
+		_Pending.erase(_Pending.begin() + ix);
+		finished++;
+		try {
+			shader->__FinishCompile();
+		}
+		catch (std::runtime_error* e) {
+			// The error has already been logged, the shader just never becomes ready
+			LOG_ERROR("Shader '{}' failed to build, it will not be drawn", shader->DebugName);
+			delete e;
+		}
+	}
+	return finished;
+}
+
+void Shader::__BeginCompile(const char* vs_source, const char* fs_source) {
+	myCompileStart = std::chrono::high_resolution_clock::now();
+	myIsReady = false;
+	myParts[0] = myParts[1] = 0;
+
+	// If we've linked this exact program with this driver before, we can skip straight to the result
+	myCacheKey = ShaderCache::GetKey(vs_source, fs_source);
+	if (ShaderCache::TryLoad(myShaderHandle, myCacheKey)) {
+		LOG_TRACE("Shader has been loaded from the cache");
+		return;
+	}
+
+	// Compile our two shader programs. We don't ask how they went yet, since that would wait for the driver
+	myParts[0] = __CompileShaderPart(vs_source, GL_VERTEX_SHADER);
+	myParts[1] = __CompileShaderPart(fs_source, GL_FRAGMENT_SHADER);
 
 	// Attach our two shaders
-	glAttachShader(myShaderHandle, vs);
-	glAttachShader(myShaderHandle, fs);
+	glAttachShader(myShaderHandle, myParts[0]);
+	glAttachShader(myShaderHandle, myParts[1]);
 
-	// Perform linking
+	// Perform linking, letting the driver know that we'll want the binary for our cache
+	glProgramParameteri(myShaderHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(myShaderHandle);
+}
 
-	// Remove shader parts to save space
-	glDetachShader(myShaderHandle, vs);
-	glDeleteShader(vs);
-	glDetachShader(myShaderHandle, fs);
-	glDeleteShader(fs);
-
-	// Get whether the link was successful
-	GLint success = 0;
-	glGetProgramiv(myShaderHandle, GL_LINK_STATUS, &success);
-
-	// If not, we need to grab the log and throw an exception
-	if (success == GL_FALSE) {
-		// Get the length of the log
-		GLint length = 0;
-		glGetProgramiv(myShaderHandle, GL_INFO_LOG_LENGTH, &length);
-
-		if (length > 0) {
-			// Read the log from openGL
-			char* log = new char[length];
-			glGetProgramInfoLog(myShaderHandle, length, &length, log);
-			LOG_ERROR("Shader failed to link:\n{}", log);
-			delete[] log;
+bool Shader::__IsLinkComplete() const {
+	// Without the extension we have no way to ask, so we have to assume it's done and wait if it isn't
+	if (!_ParallelCompile)
+		return true;
+	GLint complete = GL_FALSE;
+	glGetProgramiv(myShaderHandle, CompletionStatus, &complete);
+	return complete == GL_TRUE;
+}
+
+void Shader::__FinishCompile() {
+	bool cached = myParts[0] == 0;
+	if (!cached) {
+		// We check the parts first, since their logs say a lot more about what went wrong than the link log does
+		bool compiled = __CheckShaderPart(myParts[0]);
+		compiled = __CheckShaderPart(myParts[1]) && compiled;
+
+		// Remove shader parts to save space
+		for (GLuint& part : myParts) {
+			glDetachShader(myShaderHandle, part);
+			glDeleteShader(part);
+			part = 0;
+		}
+		if (!compiled)
+			throw new std::runtime_error("Failed to compile shader part!");
+
+		// Get whether the link was successful
+		GLint success = 0;
+		glGetProgramiv(myShaderHandle, GL_LINK_STATUS, &success);
+
+		// If not, we need to grab the log and throw an exception
+		if (success == GL_FALSE) {
+			// Get the length of the log
+			GLint length = 0;
+			glGetProgramiv(myShaderHandle, GL_INFO_LOG_LENGTH, &length);
+
+			if (length > 0) {
+				// Read the log from openGL
+				char* log = new char[length];
+				glGetProgramInfoLog(myShaderHandle, length, &length, log);
+				LOG_ERROR("Shader failed to link:\n{}", log);
+				delete[] log;
+			}
+			else {
+				LOG_ERROR("Shader failed to link for an unknown reason!");
+			}
+
+			// Throw a runtime exception, the program itself is cleaned up when we are destroyed
+			throw new std::runtime_error("Failed to link shader program!");
 		}
 		else {
-			LOG_ERROR("Shader failed to link for an unknown reason!");
+			LOG_TRACE("Shader has been linked");
 		}
 
-		// Delete the partial program
-		glDeleteProgram(myShaderHandle);
-
-		// Throw a runtime exception
-		throw new std::runtime_error("Failed to link shader program!");
+		ShaderCache::Write(myShaderHandle, myCacheKey);
 	}
-	else {
-		LOG_TRACE("Shader has been linked");
+
+	// Shaders that read their transforms from the DrawBatcher's storage buffer can be drawn in batches
+	mySupportsBatching = glGetProgramResourceIndex(myShaderHandle, GL_SHADER_STORAGE_BLOCK, "DrawData") != GL_INVALID_INDEX;
+
+	__ReflectUniforms();
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - myCompileStart).count();
+	ShaderCache::CountInit(cached, elapsedMs);
+	myIsReady = true;
+}
+
+void Shader::__ReflectUniforms() {
+	myUniformLocations.clear();
+	GLint count = 0;
+	glGetProgramInterfaceiv(myShaderHandle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	GLint maxNameLength = 0;
+	glGetProgramInterfaceiv(myShaderHandle, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+	std::vector<char> name(std::max(maxNameLength, 1));
+
+	const GLenum properties[2] = { GL_LOCATION, GL_ARRAY_SIZE };
+	for (GLint ix = 0; ix < count; ix++) {
+		GLint values[2] = { -1, 1 };
+		glGetProgramResourceiv(myShaderHandle, GL_UNIFORM, ix, 2, properties, 2, nullptr, values);
+		// Uniforms inside of blocks don't have locations, they get set through their buffers instead
+		if (values[0] == -1)
+			continue;
+		glGetProgramResourceName(myShaderHandle, GL_UNIFORM, ix, static_cast<GLsizei>(name.size()), nullptr, name.data());
+		// Arrays are reported once as "name[0]", the rest of their elements follow on from the first location
+		std::string base = name.data();
+		if (values[1] > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+			base.resize(base.size() - 3);
+		for (GLint element = 0; element < values[1]; element++) {
+			UniformId id = GetUniformId(element == 0 ? base : base + "[" + std::to_string(element) + "]");
+			if (id >= myUniformLocations.size())
+				myUniformLocations.resize(id + 1, -1);
+			myUniformLocations[id] = values[0] + element;
+		}
 	}
+	LOG_TRACE("Shader has {} active uniforms", count);
+}
+
+GLint Shader::__FindLocation(const char* name) {
+	_FrameStats.NameLookups++;
+	std::unordered_map<std::string, UniformId>& ids = UniformIds();
+	size_t length = strlen(name);
+	auto it = length > 3 && strcmp(name + length - 3, "[0]") == 0 ? ids.find(std::string(name, length - 3)) : ids.find(name);
+	// Every active uniform got an ID when we were linked, so a name without one can't be in this shader
+	return it != ids.end() ? GetUniformLocation(it->second) : -1;
 }
 
-void Shader::Load(const char* vsFile, const char* fsFile)
+void Shader::Load(const char* vsFile, const char* fsFile, const ShaderDefines& defines)
 {
-	// Load in our shaders
-	char* vs_source = readFile(vsFile);
-	char* fs_source = readFile(fsFile);
+	// Load in our shaders, pasting in their includes and adding our defines
+	std::string vs_source = ShaderPreprocessor::Process(vsFile, defines);
+	std::string fs_source = ShaderPreprocessor::Process(fsFile, defines);
 
 	// Compile our program
-	Compile(vs_source, fs_source);
+	Compile(vs_source.c_str(), fs_source.c_str());
+}
+
+void Shader::LoadAsync(const char* vsFile, const char* fsFile, const ShaderDefines& defines)
+{
+	std::string vs_source = ShaderPreprocessor::Process(vsFile, defines);
+	std::string fs_source = ShaderPreprocessor::Process(fsFile, defines);
 
-	// Clean up our memory
-	delete[] fs_source;
-	delete[] vs_source;
+	// The driver takes its own copy of our sources, so they don't need to outlive this
+	CompileAsync(vs_source.c_str(), fs_source.c_str());
 }
 
 void Shader::SetUniform(const char* name, const glm::mat4& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
 	if (loc != -1) {
 		glProgramUniformMatrix4fv(myShaderHandle, loc, 1, false, &value[0][0]);
 	}
+	_FrameStats.LookupsAvoided++;
 }
 
 void Shader::SetUniform(const char* name, const glm::vec4& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
 	if (loc != -1) {
 		glProgramUniform4fv(myShaderHandle, loc, 1, &value[0]);
 	}
+	_FrameStats.LookupsAvoided++;
 }
 
 void Shader::SetUniform(const char* name, const glm::mat3& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
 	if (loc != -1) {
 		glProgramUniformMatrix3fv(myShaderHandle, loc, 1, false, &value[0][0]);
 	}
+	_FrameStats.LookupsAvoided++;
 }
+
 void Shader::SetUniform(const char* name, const glm::vec3& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
 	if (loc != -1) {
 		glProgramUniform3fv(myShaderHandle, loc, 1, &value[0]);
 	}
+	_FrameStats.LookupsAvoided++;
 }
+
 void Shader::SetUniform(const char* name, const float& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
 	if (loc != -1) {
 		glProgramUniform1fv(myShaderHandle, loc, 1, &value);
 	}
+	_FrameStats.LookupsAvoided++;
 }
 
 void Shader::SetUniform(const char* name, const int& value) {
-	GLint loc = glGetUniformLocation(myShaderHandle, name);
+	GLint loc = __FindLocation(name);
+	if (loc != -1) {
+		glProgramUniform1iv(myShaderHandle, loc, 1, &value);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const glm::mat4& value) {
+	GLint loc = GetUniformLocation(id);
+	if (loc != -1) {
+		glProgramUniformMatrix4fv(myShaderHandle, loc, 1, false, &value[0][0]);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const glm::vec4& value) {
+	GLint loc = GetUniformLocation(id);
+	if (loc != -1) {
+		glProgramUniform4fv(myShaderHandle, loc, 1, &value[0]);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const glm::mat3& value) {
+	GLint loc = GetUniformLocation(id);
+	if (loc != -1) {
+		glProgramUniformMatrix3fv(myShaderHandle, loc, 1, false, &value[0][0]);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const glm::vec3& value) {
+	GLint loc = GetUniformLocation(id);
+	if (loc != -1) {
+		glProgramUniform3fv(myShaderHandle, loc, 1, &value[0]);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const float& value) {
+	GLint loc = GetUniformLocation(id);
+	if (loc != -1) {
+		glProgramUniform1fv(myShaderHandle, loc, 1, &value);
+	}
+	_FrameStats.LookupsAvoided++;
+}
+
+void Shader::SetUniform(UniformId id, const int& value) {
+	GLint loc = GetUniformLocation(id);
 	if (loc != -1) {
 		glProgramUniform1iv(myShaderHandle, loc, 1, &value);
 	}
+	_FrameStats.LookupsAvoided++;
 }
 
 void Shader::Bind() {
@@ -163,38 +379,37 @@ GLuint Shader::__CompileShaderPart(const char* source, GLenum type) {
 	glShaderSource(result, 1, &source, NULL);
 	glCompileShader(result);
 
+	// Return the shader part, its status gets checked by __CheckShaderPart once we need the program
+	return result;
+}
+
+bool Shader::__CheckShaderPart(GLuint part) {
 	// Check our compile status
 	GLint compileStatus = 0;
-	glGetShaderiv(result, GL_COMPILE_STATUS, &compileStatus);
+	glGetShaderiv(part, GL_COMPILE_STATUS, &compileStatus);
 
 	// If we failed to compile
 	if (compileStatus == GL_FALSE) {
 		// Get the size of the error log
 		GLint logSize = 0;
-		glGetShaderiv(result, GL_INFO_LOG_LENGTH, &logSize);
+		glGetShaderiv(part, GL_INFO_LOG_LENGTH, &logSize);
 
 		// Create a new character buffer for the log
-		char* log = new char[logSize];
+		char* log = new char[std::max(logSize, 1)];
+		log[0] = '\0';
 
 		// Get the log
-		glGetShaderInfoLog(result, logSize, &logSize, log);
+		glGetShaderInfoLog(part, logSize, &logSize, log);
 
 		// Dump error log
 		LOG_ERROR("Failed to compile shader part:\n{}", log);
 
 		// Clean up our log memory
 		delete[] log;
-
-		// Delete the broken shader result
-		glDeleteShader(result);
-
-		// Throw a runtime exception
-		throw new std::runtime_error("Failed to compile shader part!");
+		return false;
 	}
 	else {
 		LOG_TRACE("Shader part has been compiled!");
 	}
-
-	// Return the compiled shader part
-	return result;
+	return true;
 }
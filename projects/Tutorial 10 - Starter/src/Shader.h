@@ -1,9 +1,24 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 #include <GLM/glm.hpp>
 #include "Utils.h"
+#include "ShaderPreprocessor.h"
+
+/*
+ * How the uniforms set since the last call to Shader::BeginFrame found their locations
+ */
+struct ShaderUniformStats {
+	// The number of uniforms that were set from our location tables, every one is a glGetUniformLocation we skipped
+	size_t LookupsAvoided = 0;
+	// The number of those that were set by name, and still had to hash the name to find its ID
+	size_t NameLookups    = 0;
+};
 
 class Shader {
 public:
@@ -15,8 +30,19 @@ public:
 	void Compile(const char* vs_source, const char* fs_source);
 
 	// Loads a shader program from 2 files. vsFile is the path to the vertex shader, and fsFile is
-	// the path to the fragment shader
-	void Load(const char* vsFile, const char* fsFile);
+	// the path to the fragment shader. Both files have their #includes resolved, and get the given #defines
+	void Load(const char* vsFile, const char* fsFile, const ShaderDefines& defines = ShaderDefines());
+
+	/*
+	 * Starts compiling and linking a program without waiting on the driver. The shader can't be used until IsReady
+	 * returns true, which happens during a later call to ProcessPending. Programs found in the ShaderCache are
+	 * ready as soon as this returns, since they have nothing to wait on
+	 */
+	void CompileAsync(const char* vs_source, const char* fs_source);
+	// The same as Load, but compiles with CompileAsync
+	void LoadAsync(const char* vsFile, const char* fsFile, const ShaderDefines& defines = ShaderDefines());
+	// True once the program has been linked and can be drawn with. Shaders that fail to build never become ready
+	bool IsReady() const { return myIsReady; }
 
 	void SetUniform(const char* name, const glm::mat4& value);
 	void SetUniform(const char* name, const glm::vec4& value);
@@ -28,11 +54,86 @@ public:
 	// New in tutorial 06
 	void SetUniform(const char* name, const int& value);
 
+	/*
+	 * Uniform names are turned into IDs that are shared by every shader, which index straight into each shader's
+	 * table of locations. Code that sets the same uniform often should look its ID up once and hang on to it
+	 */
+	typedef uint32_t UniformId;
+	/*
+	 * Gets the ID for a uniform name, adding one if the name hasn't been seen yet. Each element of an array has its
+	 * own ID (ex: "s_Albedos[1]"), and the first element can be named with or without its [0]. This must be called
+	 * on the OpenGL thread
+	 */
+	static UniformId GetUniformId(const std::string& name);
+
+	void SetUniform(UniformId id, const glm::mat4& value);
+	void SetUniform(UniformId id, const glm::vec4& value);
+	void SetUniform(UniformId id, const glm::mat3& value);
+	void SetUniform(UniformId id, const glm::vec3& value);
+	void SetUniform(UniformId id, const float& value);
+	void SetUniform(UniformId id, const int& value);
+
+	// Gets the location of a uniform, or -1 if it isn't an active uniform in this shader
+	GLint GetUniformLocation(UniformId id) const { return id < myUniformLocations.size() ? myUniformLocations[id] : -1; }
+
 	void Bind();
 
+	// True if the shader reads its transforms from the DrawData storage block, so that it can be drawn with DrawBatcher
+	bool SupportsBatching() const { return mySupportsBatching; }
+
+	// Resets the uniform statistics, this should be called at the start of each frame
+	static void BeginFrame() { _FrameStats = ShaderUniformStats(); }
+	// Gets how uniforms have been set since the last call to BeginFrame
+	static const ShaderUniformStats& GetFrameStats() { return _FrameStats; }
+
+	/*
+	 * Checks if the driver supports GL_KHR_parallel_shader_compile (or the ARB version of it), and lets it use as
+	 * many compiler threads as it likes. This should be called once, after the context has been created
+	 * @param loader The function to load the extension's entry points with (ex: glfwGetProcAddress)
+	 */
+	static void InitParallelCompile(GLADloadproc loader);
+	// True if InitParallelCompile found the extension, so that we can poll shaders instead of waiting on them
+	static bool SupportsParallelCompile() { return _ParallelCompile; }
+	/*
+	 * Finishes shaders started with CompileAsync, this should be called on the OpenGL thread once per frame. With
+	 * parallel compiles, only shaders that the driver is done with are touched, so this never waits. Without them,
+	 * we finish shaders until we run out of time, but always at least one
+	 * @param budgetMs The time we can spend, in milliseconds
+	 * @returns The number of shaders that were finished (including ones that failed)
+	 */
+	static size_t ProcessPending(double budgetMs);
+	// Gets the number of shaders that are still waiting to be finished
+	static size_t GetPendingCount() { return _Pending.size(); }
+
 private:
 	GLuint __CompileShaderPart(const char* source, GLenum type);
+	// Logs the error if a shader part failed to compile, returns false if it did
+	bool __CheckShaderPart(GLuint part);
+	// Loads our program from the ShaderCache, or starts compiling and linking it from source
+	void __BeginCompile(const char* vs_source, const char* fs_source);
+	// True if the driver is done linking, so that __FinishCompile won't have to wait
+	bool __IsLinkComplete() const;
+	// Checks how the build went, stores new programs in the ShaderCache, and gets our uniforms. Throws on failure
+	void __FinishCompile();
+	// Fills in our location table from the active uniforms of the linked program
+	void __ReflectUniforms();
+	// Gets the location of a uniform by name, without adding an ID for it if it doesn't have one yet
+	GLint __FindLocation(const char* name);
 
 	GLuint myShaderHandle;
+	bool   mySupportsBatching;
+	bool   myIsReady;
+	// The vertex and fragment shaders that are still being compiled, 0 once we're done with them (or were cached)
+	GLuint myParts[2];
+	uint64_t myCacheKey;
+	std::chrono::high_resolution_clock::time_point myCompileStart;
+	// The location of each uniform, indexed by UniformId. IDs added after we were linked can't be active in us, so
+	// anything past the end is -1
+	std::vector<GLint> myUniformLocations;
+
+	static ShaderUniformStats _FrameStats;
+	static bool _ParallelCompile;
+	// The shaders that have been started with CompileAsync, but haven't been finished yet
+	static std::vector<Shader*> _Pending;
 };
 
@@ -0,0 +1,138 @@
+#include "ShaderCache.h"
+#include "MeshCache.h"
+#include "Logging.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// The header at the start of every .sprog file, the program binary follows directly after it
+struct ShaderCacheHeader {
+	char     Magic[4];   // Always "SPRG"
+	uint32_t Version;    // Must match ShaderCache::Version
+	uint32_t Format;     // The binary format that glGetProgramBinary gave us
+	uint32_t Reserved;
+	uint64_t Key;        // The key of the program, in case two keys ever end up with the same file name
+	uint64_t BinarySize;
+};
+static_assert(sizeof(ShaderCacheHeader) == 32, "Shader cache header must be 32 bytes");
+
+static const char ShaderCacheMagic[4] = { 'S', 'P', 'R', 'G' };
+
+const char* const ShaderCache::Folder = "shader-cache";
+ShaderCacheStats ShaderCache::_Stats;
+
+// Hashes a string from the driver, these can be null if there is no context
+static uint64_t HashGlString(GLenum name, uint64_t hash) {
+	const char* value = reinterpret_cast<const char*>(glGetString(name));
+	return value != nullptr ? MeshCache::HashBytes(value, strlen(value) + 1, hash) : hash;
+}
+
+uint64_t ShaderCache::GetKey(const char* vsSource, const char* fsSource) {
+	// The driver won't change while we're running, so we only need to hash it once
+	static const uint64_t driverHash = HashGlString(GL_VERSION, HashGlString(GL_RENDERER, HashGlString(GL_VENDOR, MeshCache::HashSeed)));
+	// We include the null terminators, so that moving text from the end of one source to the start of the other changes the key
+	uint64_t hash = MeshCache::HashBytes(vsSource, strlen(vsSource) + 1, driverHash);
+	return MeshCache::HashBytes(fsSource, strlen(fsSource) + 1, hash);
+}
+
+std::string ShaderCache::GetCachePath(uint64_t key) {
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return std::string(Folder) + "/" + name + ".sprog";
+}
+
+bool ShaderCache::TryLoad(GLuint program, uint64_t key) {
+	// Some drivers don't support any binary formats at all
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount == 0)
+		return false;
+
+	std::string cachePath = GetCachePath(key);
+	std::ifstream file(cachePath, std::ios::binary);
+	ShaderCacheHeader header;
+	if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(ShaderCacheHeader)))
+		return false;
+	if (memcmp(header.Magic, ShaderCacheMagic, sizeof(ShaderCacheMagic)) != 0 ||
+		header.Version != Version ||
+		header.Key != key) {
+		LOG_TRACE("Shader cache '{}' is out of date", cachePath);
+		return false;
+	}
+
+	std::vector<char> binary(static_cast<size_t>(header.BinarySize));
+	if (!file.read(binary.data(), binary.size())) {
+		LOG_WARN("Shader cache '{}' is corrupt, recompiling", cachePath);
+		return false;
+	}
+
+	// The driver can still turn the binary down (ex: after an update that kept the same version string)
+	glProgramBinary(program, header.Format, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE) {
+		LOG_TRACE("Driver rejected shader cache '{}', recompiling", cachePath);
+		_Stats.Rejected++;
+		return false;
+	}
+	return true;
+}
+
+bool ShaderCache::Write(GLuint program, uint64_t key) {
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formatCount == 0 || length <= 0)
+		return false;
+
+	ShaderCacheHeader header;
+	memcpy(header.Magic, ShaderCacheMagic, sizeof(ShaderCacheMagic));
+	header.Version  = Version;
+	header.Reserved = 0;
+	header.Key      = key;
+	std::vector<char> binary(length);
+	GLenum format = GL_NONE;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.Format     = format;
+	header.BinarySize = static_cast<uint64_t>(length);
+
+	std::error_code error;
+	std::filesystem::create_directories(Folder, error);
+	std::string cachePath = GetCachePath(key);
+	// We write to a temporary file first, so that a failed write never leaves a broken cache behind
+	std::string tempPath  = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ShaderCacheHeader));
+		file.write(binary.data(), length);
+		if (!file) {
+			LOG_WARN("Failed to write shader cache '{}'", cachePath);
+			file.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error) {
+		LOG_WARN("Failed to write shader cache '{}': {}", cachePath, error.message());
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+void ShaderCache::CountInit(bool cached, double milliseconds) {
+	if (cached) {
+		_Stats.Hits++;
+		_Stats.WarmMs += milliseconds;
+	}
+	else {
+		_Stats.Misses++;
+		_Stats.ColdMs += milliseconds;
+	}
+}
@@ -0,0 +1,72 @@
+/*
+	Handles reading and writing our shader program cache files (.sprog), which store the driver's linked binary
+	for a program so that we don't need to compile and link its GLSL on every launch. Binaries are only valid for
+	the driver that made them, so the driver is part of each cache's key, and we fall back to compiling if the
+	driver turns a binary down anyways
+*/
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+/*
+ * How our shader programs were initialized since launch, cached programs are warm and compiled ones are cold
+ */
+struct ShaderCacheStats {
+	size_t Hits      = 0;
+	size_t Misses    = 0;
+	// The number of cached binaries that the driver would not accept
+	size_t Rejected  = 0;
+	// The total time spent loading programs from the cache, and compiling the ones that weren't in it
+	double WarmMs    = 0.0;
+	double ColdMs    = 0.0;
+};
+
+class ShaderCache {
+public:
+	/*
+	 * The version of the cache format, this should be bumped whenever the layout of the file changes
+	 */
+	static const uint32_t Version = 1;
+
+	/*
+	 * The folder that cache files are written to, relative to the working directory
+	 */
+	static const char* const Folder;
+
+	/*
+	 * Gets the key for a program, a hash of its sources along with the vendor, renderer and version of the current
+	 * OpenGL driver. Anything that changes a program's source (ex: preprocessor defines) changes its key. This must
+	 * be called on the OpenGL thread
+	 */
+	static uint64_t GetKey(const char* vsSource, const char* fsSource);
+
+	/*
+	 * Gets the path of the cache file for a program key (Folder/<key in hex>.sprog)
+	 */
+	static std::string GetCachePath(uint64_t key);
+
+	/*
+	 * Attempts to load a program from the cache. The program must not be linked yet
+	 * @param program The program to load the binary into
+	 * @param key     The program's key, see GetKey
+	 * @returns True if the program was loaded and linked successfully, false if it needs to be compiled
+	 */
+	static bool TryLoad(GLuint program, uint64_t key);
+
+	/*
+	 * Writes the binary for a linked program to the cache. The program should have been linked with
+	 * GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	 * @returns True if the cache was written
+	 */
+	static bool Write(GLuint program, uint64_t key);
+
+	// Notes how long it took to initialize a program, for our statistics
+	static void CountInit(bool cached, double milliseconds);
+	// Gets how our programs have been initialized since launch
+	static const ShaderCacheStats& GetStats() { return _Stats; }
+
+private:
+	static ShaderCacheStats _Stats;
+};
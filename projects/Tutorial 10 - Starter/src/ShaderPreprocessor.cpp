@@ -0,0 +1,118 @@
+#include "ShaderPreprocessor.h"
+#include "FileStream.h"
+#include "Logging.h"
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+// Splits a file into its lines, dropping the line endings (either \n or \r\n)
+static std::vector<std::string> SplitLines(const std::vector<char>& contents) {
+	std::vector<std::string> lines;
+	size_t start = 0;
+	for (size_t ix = 0; ix <= contents.size(); ix++) {
+		if (ix == contents.size() || contents[ix] == '\n') {
+			size_t end = ix;
+			if (end > start && contents[end - 1] == '\r')
+				end--;
+			if (ix < contents.size() || end > start)
+				lines.emplace_back(contents.data() + start, end - start);
+			start = ix + 1;
+		}
+	}
+	return lines;
+}
+
+// Checks if a line is the given directive, ignoring any whitespace before it or between the # and the name
+static bool IsDirective(const std::string& line, const char* name, size_t* afterName = nullptr) {
+	size_t pos = line.find_first_not_of(" \t");
+	if (pos == std::string::npos || line[pos] != '#')
+		return false;
+	pos = line.find_first_not_of(" \t", pos + 1);
+	size_t length = strlen(name);
+	if (pos == std::string::npos || line.compare(pos, length, name) != 0)
+		return false;
+	if (afterName != nullptr)
+		*afterName = pos + length;
+	return true;
+}
+
+std::string ShaderPreprocessor::Process(const char* filename, const ShaderDefines& defines) {
+	std::string result;
+	std::set<std::string> included;
+	std::string path = std::filesystem::path(filename).lexically_normal().generic_string();
+	included.insert(path);
+	__ProcessFile(path, &defines, result, included, 0);
+	return result;
+}
+
+std::string ShaderPreprocessor::GetDefinesKey(const ShaderDefines& defines) {
+	std::string result;
+	for (const auto& kvp : defines)
+		result += kvp.first + "=" + kvp.second + ";";
+	return result;
+}
+
+void ShaderPreprocessor::__ProcessFile(const std::string& filename, const ShaderDefines* defines, std::string& result,
+	std::set<std::string>& included, int depth)
+{
+	FileStream file(filename.c_str());
+	std::vector<char> contents;
+	if (!file.IsOpen() || !file.ReadAll(contents)) {
+		LOG_ERROR("Failed to read shader file '{}'", filename);
+		throw new std::runtime_error("Failed to read shader file!");
+	}
+	// The source string number that the driver will report errors in this file with, we were the last file added
+	size_t fileIndex = included.size() - 1;
+	std::vector<std::string> lines = SplitLines(contents);
+
+	// The defines go after the #version line, since that has to come before anything else
+	bool needsDefines = defines != nullptr && !defines->empty();
+	bool hasVersion = false;
+	for (const std::string& line : lines)
+		hasVersion |= IsDirective(line, "version");
+	auto addDefines = [&](size_t nextLine) {
+		for (const auto& kvp : *defines)
+			result += "#define " + kvp.first + " " + kvp.second + "\n";
+		result += "#line " + std::to_string(nextLine) + " " + std::to_string(fileIndex) + "\n";
+		needsDefines = false;
+	};
+	if (needsDefines && !hasVersion)
+		addDefines(1);
+
+	for (size_t ix = 0; ix < lines.size(); ix++) {
+		const std::string& line = lines[ix];
+		size_t afterName = 0;
+		if (!IsDirective(line, "include", &afterName)) {
+			result += line;
+			result += "\n";
+			if (needsDefines && IsDirective(line, "version"))
+				addDefines(ix + 2);
+			continue;
+		}
+
+		// We accept both "file" and <file>, they both mean relative to this file
+		size_t open = line.find_first_of("\"<", afterName);
+		size_t close = open == std::string::npos ? open : line.find_first_of(line[open] == '"' ? "\"" : ">", open + 1);
+		if (close == std::string::npos) {
+			LOG_ERROR("{}({}): Malformed #include", filename, ix + 1);
+			throw new std::runtime_error("Malformed shader #include!");
+		}
+		std::filesystem::path path = std::filesystem::path(filename).parent_path() / line.substr(open + 1, close - open - 1);
+		std::string includePath = path.lexically_normal().generic_string();
+
+		// Every file is only pasted in once, which also stops files from including each other forever
+		if (!included.insert(includePath).second) {
+			result += "\n";
+			continue;
+		}
+		if (depth + 1 > MaxIncludeDepth) {
+			LOG_ERROR("{}({}): Includes are nested too deep", filename, ix + 1);
+			throw new std::runtime_error("Shader includes are nested too deep!");
+		}
+		result += "#line 1 " + std::to_string(included.size() - 1) + "\n";
+		__ProcessFile(includePath, nullptr, result, included, depth + 1);
+		result += "#line " + std::to_string(ix + 2) + " " + std::to_string(fileIndex) + "\n";
+	}
+}
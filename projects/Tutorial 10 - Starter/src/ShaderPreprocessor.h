@@ -0,0 +1,50 @@
+/*
+	Turns a GLSL file into the single source string that we hand to the driver. Lines like
+
+		#include "include/blinn-phong.glsl"
+
+	are replaced with the contents of the file, relative to the file that included it, and a set of #defines is
+	added straight after the #version line. This lets shaders share code, and lets materials ask for specialized
+	variants of a shader (ex: a fixed number of waves) instead of branching on uniforms at runtime
+*/
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+/*
+ * The #defines to compile a shader with, mapped to their values. These are sorted so that the same set always
+ * makes the same source, and the same key
+ */
+typedef std::map<std::string, std::string> ShaderDefines;
+
+class ShaderPreprocessor {
+public:
+	/*
+	 * Loads a shader file, resolving its includes and adding the given defines. Each file is only ever included
+	 * once per shader, as if every file started with #pragma once. A #line directive is added around each include
+	 * so that compile errors point at the right line, using the order the files were included in as the source
+	 * string number (0 is the file itself)
+	 * @param filename The path of the shader to load
+	 * @param defines  The #defines to add to the top of the shader
+	 * @returns The processed source, throws a std::runtime_error* if a file could not be read or an include is malformed
+	 */
+	static std::string Process(const char* filename, const ShaderDefines& defines = ShaderDefines());
+
+	/*
+	 * Gets a string that is unique for a set of defines, for use in cache keys (ex: "MAX_WAVES=4;USE_FOG=1;")
+	 */
+	static std::string GetDefinesKey(const ShaderDefines& defines);
+
+	// The deepest we will follow nested includes
+	static constexpr int MaxIncludeDepth = 16;
+
+private:
+	/*
+	 * Appends a file to result, following its includes
+	 * @param defines The defines to add after the file's #version line, only given for the top level file
+	 */
+	static void __ProcessFile(const std::string& filename, const ShaderDefines* defines, std::string& result,
+		std::set<std::string>& included, int depth);
+};
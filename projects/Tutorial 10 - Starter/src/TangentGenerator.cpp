@@ -0,0 +1,115 @@
+#include "TangentGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+/*
+ * Invokes func(begin, end) over [0, count) in ranges of at most rangeSize items, spread across the global
+ * thread pool if parallel is set
+ */
+static void ForEachRange(size_t count, size_t rangeSize, bool parallel, const std::function<void(size_t, size_t)>& func) {
+	rangeSize = std::max(rangeSize, (size_t)1);
+	size_t numRanges = (count + rangeSize - 1) / rangeSize;
+	if (!parallel || numRanges < 2) {
+		func(0, count);
+		return;
+	}
+	ThreadPool::Global().ParallelFor(numRanges, [&](size_t ix) {
+		func(ix * rangeSize, std::min(count, (ix + 1) * rangeSize));
+	});
+}
+
+// Gets a unit vector perpendicular to the normal, for vertices that have nothing better to go on
+static glm::vec3 AnyTangent(const glm::vec3& normal) {
+	glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	return glm::normalize(axis - normal * glm::dot(normal, axis));
+}
+
+// Projects a vector onto the plane with the given unit normal, and normalizes it (or returns 0 if nothing is left)
+static glm::vec3 ProjectOnto(const glm::vec3& normal, const glm::vec3& vector) {
+	glm::vec3 result = vector - normal * glm::dot(normal, vector);
+	float length = glm::length(result);
+	return length > 0.0f ? result / length : glm::vec3(0.0f);
+}
+
+void TangentGenerator::Generate(MeshData& data, const TangentOptions& options) {
+	size_t vertexCount   = data.Vertices.size();
+	size_t triangleCount = data.Indices.size() / 3;
+	const uint32_t* indices  = data.Indices.data();
+	Vertex*         vertices = data.Vertices.data();
+
+	// Start with the direction that U increases in across each triangle, and whether the triangle is mirrored in UV
+	// space (the sign of its UV area). Triangles with no area in UV space get a W of 0, and don't contribute
+	std::vector<glm::vec4> faceTangents(triangleCount);
+	ForEachRange(triangleCount, options.TrianglesPerRange, options.Parallel, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			const Vertex& v0 = vertices[indices[ix * 3 + 0]];
+			const Vertex& v1 = vertices[indices[ix * 3 + 1]];
+			const Vertex& v2 = vertices[indices[ix * 3 + 2]];
+			glm::vec3 e1 = v1.Position - v0.Position, e2 = v2.Position - v0.Position;
+			glm::vec2 t1 = v1.UV - v0.UV,             t2 = v2.UV - v0.UV;
+			float signedArea = t1.x * t2.y - t1.y * t2.x;
+			glm::vec3 tangent = e1 * t2.y - e2 * t1.y;
+			float length = glm::length(tangent);
+			if (signedArea == 0.0f || length == 0.0f) {
+				faceTangents[ix] = glm::vec4(0.0f);
+				continue;
+			}
+			float sign = signedArea > 0.0f ? 1.0f : -1.0f;
+			faceTangents[ix] = glm::vec4(tangent * (sign / length), sign);
+		}
+	});
+
+	// Find the corners that use each vertex, so that every vertex can be summed up on its own without any locking.
+	// Corners are listed in index order, which keeps the sums (and our results) the same no matter how we split the work
+	std::vector<uint32_t> cornerOffsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < triangleCount * 3; ix++)
+		cornerOffsets[indices[ix] + 1]++;
+	for (size_t ix = 0; ix < vertexCount; ix++)
+		cornerOffsets[ix + 1] += cornerOffsets[ix];
+	std::vector<uint32_t> corners(triangleCount * 3);
+	{
+		std::vector<uint32_t> cursors(cornerOffsets.begin(), cornerOffsets.end() - 1);
+		for (size_t ix = 0; ix < triangleCount * 3; ix++)
+			corners[cursors[indices[ix]]++] = static_cast<uint32_t>(ix);
+	}
+
+	// Each vertex takes the face tangents flattened onto its own normal, weighted by the angle of its corner in
+	// that face, so that how finely a surface is split up doesn't change the result
+	ForEachRange(vertexCount, options.TrianglesPerRange, options.Parallel, [&](size_t begin, size_t end) {
+		for (size_t ix = begin; ix < end; ix++) {
+			Vertex& vertex = vertices[ix];
+			float normalLength = glm::length(vertex.Normal);
+			glm::vec3 normal = normalLength > 0.0f ? vertex.Normal / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+			glm::vec3 tangent = glm::vec3(0.0f);
+			float     sign    = 0.0f;
+			for (uint32_t jx = cornerOffsets[ix]; jx < cornerOffsets[ix + 1]; jx++) {
+				uint32_t corner   = corners[jx];
+				uint32_t triangle = corner / 3;
+				const glm::vec4& face = faceTangents[triangle];
+				if (face.w == 0.0f)
+					continue;
+				glm::vec3 faceTangent = ProjectOnto(normal, glm::vec3(face));
+				if (faceTangent == glm::vec3(0.0f))
+					continue;
+
+				const glm::vec3& position = vertex.Position;
+				const glm::vec3& next = vertices[indices[triangle * 3 + (corner + 1) % 3]].Position;
+				const glm::vec3& prev = vertices[indices[triangle * 3 + (corner + 2) % 3]].Position;
+				glm::vec3 toNext = ProjectOnto(normal, next - position);
+				glm::vec3 toPrev = ProjectOnto(normal, prev - position);
+				float angle = glm::acos(glm::clamp(glm::dot(toNext, toPrev), -1.0f, 1.0f));
+
+				tangent += faceTangent * angle;
+				sign    += face.w * angle;
+			}
+
+			float length = glm::length(tangent);
+			if (length > 0.0f)
+				vertex.Tangent = glm::vec4(tangent / length, sign < 0.0f ? -1.0f : 1.0f);
+			else
+				vertex.Tangent = glm::vec4(AnyTangent(normal), 1.0f);
+		}
+	});
+}
@@ -0,0 +1,36 @@
+/*
+	Generates the tangent frames that normal mapping needs, following the conventions of MikkTSpace (the
+	generator Blender, Substance and most bakers use), so that normal maps baked by those tools come out
+	right: tangents are orthogonal to the vertex normal, each triangle contributes by its corner angle, and
+	the bitangent is rebuilt in the shader as cross(normal, tangent.xyz) * tangent.w
+*/
+#pragma once
+
+#include "Mesh.h"
+
+/*
+ * Settings for generating tangents
+ */
+struct TangentOptions {
+	/*
+	 * True if the work should be spread across the global thread pool. The result is identical either way
+	 */
+	bool   Parallel          = true;
+	/*
+	 * The number of triangles (or vertices) that each job works through, meshes smaller than this are
+	 * always done on the calling thread
+	 */
+	size_t TrianglesPerRange = 64 * 1024;
+};
+
+class TangentGenerator {
+public:
+	/*
+	 * Fills in the Tangent of every vertex in the mesh from its positions, normals and UVs. Vertices that
+	 * have no UVs (or whose triangles have no area in UV space) get an arbitrary tangent that is still
+	 * perpendicular to their normal
+	 * @param data    The mesh to generate tangents for, the normals should already be set
+	 * @param options The settings to use
+	 */
+	static void Generate(MeshData& data, const TangentOptions& options = TangentOptions());
+};
@@ -1,5 +1,6 @@
 #include "Texture2D.h"
 #include "Logging.h"
+#include "FileStream.h"
 #include <stb_image.h>
 #include <GLM/gtc/integer.hpp>
 #include <GLM/gtc/type_ptr.hpp>
@@ -62,7 +63,7 @@ void Texture2D::LoadData(void* data, size_t width, size_t height, PixelFormat fo
 Texture2D::Sptr Texture2D::LoadFromFile(const std::string& fileName, bool loadAlpha) {
 
 	int width, height, numChannels;
-	void* data = stbi_load(fileName.c_str(), &width, &height, &numChannels, loadAlpha ? 4 : 3);
+	void* data = FileStream::LoadImageFile(fileName.c_str(), &width, &height, &numChannels, loadAlpha ? 4 : 3);
 
 	if (data != nullptr && width != 0 && height != 0 && numChannels != 0) {
 		Texture2DDescription desc = Texture2DDescription();
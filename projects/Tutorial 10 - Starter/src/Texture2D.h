@@ -73,6 +73,8 @@ public:
 	
 	static Sptr LoadFromFile(const std::string& fileName, bool loadAlpha = true);
 
+	const Texture2DDescription& GetDescription() const { return myDescription; }
+
 protected:
 	GLuint               myTextureHandle;
 	Texture2DDescription myDescription;
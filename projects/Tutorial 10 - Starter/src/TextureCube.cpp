@@ -1,5 +1,6 @@
 #include "TextureCube.h"
 #include "Logging.h"
+#include "FileStream.h"
 #include "stb_image.h"
 
 TextureCube::TextureCube(const TextureCubeDesc& desc) {
@@ -38,7 +39,7 @@ TextureCube::Sptr TextureCube::LoadFromFiles(const std::string faceFiles[6]) {
 	
 	for (int ix = 0; ix < 6; ix++) {
 		int width, height, numChannels;
-		void* data = stbi_load(faceFiles[ix].c_str(), &width, &height, &numChannels, 3);
+		void* data = FileStream::LoadImageFile(faceFiles[ix].c_str(), &width, &height, &numChannels, 3);
 		if (desc.Size != 0 && ((width != desc.Size) | (height != desc.Size))) {
 			stbi_image_free(data);
 			LOG_ASSERT(false, "Image file dimensions do not match the size of this cubemap! ({})", faceFiles[ix]);
@@ -63,5 +64,7 @@ TextureCube::Sptr TextureCube::LoadFromFiles(const std::string faceFiles[6]) {
 		}
 			
 	}
+	// The flip is global, so we turn it back off to avoid flipping every image loaded after us
+	stbi_set_flip_vertically_on_load(false);
 	return result;
 }
\ No newline at end of file
@@ -31,6 +31,8 @@ public:
 	
 	void Bind(int slot);
 	static void Unbind(int slot);
+
+	const TextureCubeDesc& GetDescription() const { return myDesc; }
 	
 protected:
 	GLuint myHandle;
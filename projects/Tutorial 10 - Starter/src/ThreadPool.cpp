@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t numThreads) : isStopping(false) {
+	if (numThreads == 0)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	myWorkers.reserve(numThreads);
+	for (size_t ix = 0; ix < numThreads; ix++) {
+		myWorkers.emplace_back(&ThreadPool::__WorkerMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	// Let the workers know they should exit once the queue has been drained
+	{
+		std::unique_lock<std::mutex> lock(myMutex);
+		isStopping = true;
+	}
+	myCondition.notify_all();
+	for (std::thread& worker : myWorkers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func) {
+	if (count == 0)
+		return;
+
+	// The state is shared with the helper jobs, since they may only get picked up after we have returned
+	struct State {
+		std::function<void(size_t)> Func;
+		std::atomic<size_t>         Next{ 0 };
+		size_t                      Count{ 0 };
+		size_t                      Completed{ 0 };
+		std::mutex                  Mutex;
+		std::condition_variable     Done;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->Func  = func;
+	state->Count = count;
+
+	// Each participant grabs items until there are none left
+	auto work = [](const std::shared_ptr<State>& state) {
+		size_t finished = 0;
+		for (size_t ix = state->Next++; ix < state->Count; ix = state->Next++) {
+			state->Func(ix);
+			finished++;
+		}
+		if (finished > 0) {
+			std::unique_lock<std::mutex> lock(state->Mutex);
+			state->Completed += finished;
+			if (state->Completed == state->Count)
+				state->Done.notify_all();
+		}
+	};
+
+	// Hand out one helper per worker (we don't need more helpers than items, since we do one ourselves)
+	size_t numHelpers = std::min(myWorkers.size(), count - 1);
+	for (size_t ix = 0; ix < numHelpers; ix++) {
+		__Push([state, work]() { work(state); });
+	}
+
+	// The calling thread does its share of the work too, then waits for the stragglers
+	work(state);
+	std::unique_lock<std::mutex> lock(state->Mutex);
+	state->Done.wait(lock, [&]() { return state->Completed == state->Count; });
+}
+
+ThreadPool& ThreadPool::Global() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::__Push(std::function<void()>&& job) {
+	{
+		std::unique_lock<std::mutex> lock(myMutex);
+		myJobs.push(std::move(job));
+	}
+	myCondition.notify_one();
+}
+
+void ThreadPool::__WorkerMain() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(myMutex);
+			myCondition.wait(lock, [this]() { return isStopping || !myJobs.empty(); });
+			if (isStopping && myJobs.empty())
+				return;
+			job = std::move(myJobs.front());
+			myJobs.pop();
+		}
+		job();
+	}
+}
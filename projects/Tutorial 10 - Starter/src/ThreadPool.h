@@ -0,0 +1,69 @@
+/*
+	A simple pool of worker threads that we can hand CPU work off to
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "Utils.h"
+
+class ThreadPool {
+public:
+	typedef std::shared_ptr<ThreadPool> Sptr;
+	NoCopy(ThreadPool);
+	NoMove(ThreadPool);
+
+	/*
+	 * Creates a new thread pool
+	 * @param numThreads The number of worker threads to spin up (0 will use one per hardware thread)
+	 */
+	ThreadPool(size_t numThreads = 0);
+	~ThreadPool();
+
+	/*
+	 * Queues a job to run on one of the workers
+	 * @param job The function to invoke on a worker thread
+	 * @returns A future that will hold the result of the job once it has finished
+	 */
+	template <typename Func>
+	auto Enqueue(Func&& job) -> std::future<decltype(job())> {
+		typedef decltype(job()) ResultType;
+		// packaged_task is move-only, so we share it to be able to store it in a std::function
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(job));
+		std::future<ResultType> result = task->get_future();
+		__Push([task]() { (*task)(); });
+		return result;
+	}
+
+	/*
+	 * Invokes func(ix) for every ix in [0, count), spread across the workers and the calling thread.
+	 * Returns once every item has finished. This is safe to call from inside of a worker, since the
+	 * calling thread will work through the items itself if the other workers are busy
+	 * @param count The number of items to process
+	 * @param func  The function to invoke for each item
+	 */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	// Gets the number of worker threads in this pool
+	size_t GetThreadCount() const { return myWorkers.size(); }
+
+	// Gets a pool shared by the whole application, with one worker per hardware thread
+	static ThreadPool& Global();
+
+private:
+	std::vector<std::thread>          myWorkers;
+	std::queue<std::function<void()>> myJobs;
+	std::mutex                        myMutex;
+	std::condition_variable           myCondition;
+	bool                              isStopping;
+
+	void __Push(std::function<void()>&& job);
+	void __WorkerMain();
+};
@@ -0,0 +1,108 @@
+/*
+	A flat, open-addressing hash table that maps a face vertex's (position, uv, normal) index triple to
+	the index of a unique mesh vertex. Everything lives in one array, so lookups don't chase nodes around
+	the heap like std::unordered_map does
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+class VertexHashTable {
+public:
+	// The value we store in empty slots (no vertex can have this index, since our indices are 32 bit)
+	static const uint32_t Empty = static_cast<uint32_t>(-1);
+
+	/*
+	 * Creates a new table with enough room for the given number of unique vertices before it needs to grow
+	 * @param expectedCount The number of unique vertices we expect to store
+	 */
+	VertexHashTable(size_t expectedCount = 0) : myCount(0) {
+		__Allocate(__CapacityFor(expectedCount));
+	}
+
+	/*
+	 * Gets the index stored for the given key, inserting value if the key is not in the table yet
+	 * @param key      The position, uv and normal indices of the face vertex
+	 * @param value    The index to store if the key is not in the table
+	 * @param inserted Will be set to true if the value was inserted, false if the key already existed
+	 * @returns The index stored for the key
+	 */
+	inline uint32_t FindOrInsert(const glm::uvec3& key, uint32_t value, bool& inserted) {
+		// Keep our load factor under 3/4, so that probe sequences stay short
+		if ((myCount + 1) * 4 > mySlots.size() * 3)
+			__Allocate(mySlots.size() * 2);
+
+		size_t ix = __Hash(key);
+		while (true) {
+			Slot& slot = mySlots[ix];
+			if (slot.Value == Empty) {
+				slot.Key   = key;
+				slot.Value = value;
+				myCount++;
+				inserted = true;
+				return value;
+			}
+			if (slot.Key == key) {
+				inserted = false;
+				return slot.Value;
+			}
+			// Linear probing, our next slot is right beside us in memory
+			ix = (ix + 1) & myMask;
+		}
+	}
+
+	// Gets the number of unique keys in the table
+	size_t Size() const { return myCount; }
+
+	// Gets the number of bytes that the table is using for its slots
+	size_t GetSizeBytes() const { return mySlots.capacity() * sizeof(Slot); }
+
+private:
+	// 16 bytes, so 4 slots fit into each cache line
+	struct Slot {
+		glm::uvec3 Key;
+		uint32_t   Value;
+	};
+
+	std::vector<Slot> mySlots;
+	size_t            myMask;
+	int               myShift; // 64 - log2(slot count), how far to shift the hash so it lands in the table
+	size_t            myCount;
+
+	// Gets the power of two slot count that will hold the given number of keys
+	static size_t __CapacityFor(size_t count) {
+		size_t capacity = 16;
+		while (capacity * 3 < count * 4)
+			capacity *= 2;
+		return capacity;
+	}
+
+	// Packs the three indices into one 64 bit word (21 bits each), multiplies by 2^64 / phi and takes the
+	// top bits as the slot. The multiply pushes every input bit up into those top bits, so keys that only
+	// differ in their uv or normal index still land far apart, and sequential indices spread out evenly.
+	// Indices past 21 bits overlap the next field, which can only cost a collision since slots store the full key
+	inline size_t __Hash(const glm::uvec3& key) const {
+		uint64_t packed = static_cast<uint64_t>(key.x) ^ (static_cast<uint64_t>(key.y) << 21) ^ (static_cast<uint64_t>(key.z) << 42);
+		return static_cast<size_t>((packed * 0x9E3779B97F4A7C15ull) >> myShift);
+	}
+
+	// Resizes the table to the given number of slots, re-inserting any existing keys
+	void __Allocate(size_t capacity) {
+		std::vector<Slot> old = std::move(mySlots);
+		mySlots.assign(capacity, Slot{ glm::uvec3(0), Empty });
+		myMask = capacity - 1;
+		myShift = 64;
+		for (size_t c = capacity; c > 1; c >>= 1)
+			myShift--;
+		for (const Slot& slot : old) {
+			if (slot.Value != Empty) {
+				size_t ix = __Hash(slot.Key);
+				while (mySlots[ix].Value != Empty)
+					ix = (ix + 1) & myMask;
+				mySlots[ix] = slot;
+			}
+		}
+	}
+};